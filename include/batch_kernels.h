@@ -0,0 +1,41 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef BATCH_KERNELS_H
+#define BATCH_KERNELS_H
+
+namespace planner
+{
+
+/**
+ * Bound tests on structure of arrays coordinates, 8 points at a time with AVX2 (chosen at runtime) or 4 with NEON,
+ * with a scalar fallback giving the same results. Every kernel only clears the mask of the points failing the test,
+ * so several tests can be chained on the same mask.
+ */
+
+// clears mask[i] where a*x[i]+b*y[i]+c*z[i]+d, with plane={a,b,c,d}, is outside [min,max]
+void linear_bound_batch(const float* x, const float* y, const float* z, unsigned int n, const float plane[4], float min, float max, unsigned char* mask);
+
+// clears mask[i] where the angle between (x[i],y[i],z[i]) and the unit vector axis, or its opposite, has a cosine below min_cosine
+void cone_bound_batch(const float* x, const float* y, const float* z, unsigned int n, const float axis[3], float min_cosine, unsigned char* mask);
+
+// frames on the planes with normals (nx[i],ny[i],nz[i]): the z axis is the normalized normal, the x axis is direction projected
+// on the plane (the world x or y axis when direction is almost parallel to the normal) and y=z cross x
+void plane_frame_batch(const float* nx, const float* ny, const float* nz, unsigned int n, const float direction[3], float* const x_axis[3], float* const y_axis[3], float* const z_axis[3]);
+
+// instruction set used by the kernels on this cpu
+const char* batch_kernels_isa();
+
+}
+#endif // BATCH_KERNELS_H
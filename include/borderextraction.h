@@ -20,18 +20,50 @@
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include "data_types.h"
+#include "spatialindex.h"
+#include <ostream>
 
 
 using namespace planner;
 
+enum border_engines
+{
+    BOUNDARY_ESTIMATION_BORDERS=0,
+    RASTER_BORDERS=1
+};
+
 class borderExtraction
 {
 public:
+    borderExtraction();
     
-    std::list< polygon_with_normals > extractBorders(const std::vector< boost::shared_ptr< pcl::PointCloud< pcl::PointXYZRGBNormal > > >& clusters);
+    // cell size of the rasters of the planes, also used by RASTER_BORDERS
+    void setRasterSize(double raster_size_);
+    // when the spatial index of the capture is given, its tree and cluster indices are used instead of building a tree for each cluster
+    std::list< polygon_with_normals > extractBorders(const std::vector< boost::shared_ptr< pcl::PointCloud< pcl::PointXYZRGBNormal > > >& clusters, spatialIndex* index=NULL);
     
 private:
-    pcl::PointCloud< pcl::PointXYZ >::Ptr douglas_peucker_3d(pcl::PointCloud< pcl::PointXYZRGBNormal >& input, double tolerance);
+    void estimateBoundaries(const pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr& cluster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border);
+    // only the points of the cluster in [begin,end) are tested
+    void estimateBoundaries(spatialIndex& index, int cluster, unsigned int begin, unsigned int end, pcl::PointCloud< pcl::PointXYZRGBNormal >& border);
+    // ordered outer contour of the biggest blob of the raster of a cluster, traced with marching squares
+    void traceBoundary(planeRaster& raster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border);
+    // polygon, sampled normals and average normal of a cluster with its border points
+    // an ordered border is not sorted by angle before the simplification
+    void extractPolygon(const pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr& cluster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border, bool ordered, int sampler_threads, polygon_with_normals& polygon, std::ostream& log);
+    pcl::PointCloud< pcl::PointXYZ >::Ptr simplifyBorder(pcl::PointCloud< pcl::PointXYZRGBNormal >& input, bool ordered, std::ostream& log);
+    
+    // number of threads working on the clusters (0 means one per core)
+    int border_threads_;
+    // one of border_engines
+    int border_engine_;
+    double raster_size_;
+    // one of polyline_methods, with its tolerance (or number of points for DOUGLAS_PEUCKER_N)
+    int polyline_method_;
+    double polyline_tolerance_;
+    int polyline_points_;
+    // seed of the normals sampling, fixed so that runs are reproducible
+    int sampler_seed_;
     
 };
 
@@ -0,0 +1,169 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef CANDIDATE_STORE_H
+#define CANDIDATE_STORE_H
+#include <vector>
+#include <list>
+#include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
+#include "data_types.h"
+
+namespace planner
+{
+
+// joint values stored inline, at most the joints of both legs of the robot
+struct joint_values
+{
+    static const unsigned int capacity=16;
+    
+    double q[capacity];
+    unsigned int size=0;
+    
+    inline void resize(unsigned int rows)
+    {
+        if (rows>capacity)
+            throw "the chain has more joints than the candidate steps can store";
+        size=rows;
+    }
+    
+    inline void assign(const KDL::JntArray& joints)
+    {
+        resize(joints.rows());
+        for (unsigned int i=0;i<size;i++)
+            q[i]=joints(i);
+    }
+    
+    inline void toJntArray(KDL::JntArray& joints) const
+    {
+        joints.resize(size);
+        for (unsigned int i=0;i<size;i++)
+            joints(i)=q[i];
+    }
+};
+
+struct candidate
+{
+    // the id of the generated foot frame, kept by the candidates derived from it
+    int id;
+    joint_values joints;
+    joint_values start_joints;
+    joint_values end_joints;
+    KDL::Frame World_StanceFoot;
+    KDL::Frame World_MovingFoot;
+    KDL::Frame World_Waist;
+    KDL::Frame World_StartWaist;
+    KDL::Frame World_EndWaist;
+};
+
+/**
+ * Contiguous buffer of the candidate steps of a planning cycle, used by the planner and its filters instead of
+ * std::list<foot_with_joints>. clear() keeps the memory, so after the first cycles no allocation is done;
+ * the filters keep their survivors with compact(), in order.
+ */
+class candidate_store
+{
+public:
+    inline void clear() {candidates.clear();}
+    inline size_t size() const {return candidates.size();}
+    inline bool empty() const {return candidates.empty();}
+    inline void reserve(size_t n) {candidates.reserve(n);}
+    
+    inline candidate& operator[](size_t i) {return candidates[i];}
+    inline const candidate& operator[](size_t i) const {return candidates[i];}
+    inline std::vector<candidate>::iterator begin() {return candidates.begin();}
+    inline std::vector<candidate>::iterator end() {return candidates.end();}
+    inline std::vector<candidate>::const_iterator begin() const {return candidates.begin();}
+    inline std::vector<candidate>::const_iterator end() const {return candidates.end();}
+    
+    // a new candidate, its id is its position in the store (candidates are only created on an empty store)
+    inline candidate& add()
+    {
+        candidates.emplace_back();
+        candidate& added=candidates.back();
+        added.id=candidates.size()-1;
+        added.joints.size=added.start_joints.size=added.end_joints.size=0;
+        return added;
+    }
+    
+    // a copy of a candidate, with its id
+    inline candidate& add(const candidate& source)
+    {
+        candidates.push_back(source);
+        return candidates.back();
+    }
+    
+    // appends the candidates of other, with their ids
+    inline void append(const candidate_store& other)
+    {
+        candidates.insert(candidates.end(),other.candidates.begin(),other.candidates.end());
+    }
+    
+    // keeps the candidates with keep(candidate) true, moving them down in place
+    template<typename Keep> void compact(Keep keep)
+    {
+        size_t kept=0;
+        for (size_t i=0;i<candidates.size();i++)
+        {
+            if (!keep(candidates[i]))
+                continue;
+            if (kept!=i)
+                candidates[kept]=candidates[i];
+            kept++;
+        }
+        candidates.resize(kept);
+    }
+    
+private:
+    std::vector<candidate> candidates;
+};
+
+// conversions at the boundary of the planner (selection of the best step and path)
+inline void toFootWithJoints(const candidate& step, foot_with_joints& result)
+{
+    result.index=step.id;
+    step.joints.toJntArray(result.joints);
+    step.start_joints.toJntArray(result.start_joints);
+    step.end_joints.toJntArray(result.end_joints);
+    result.World_StanceFoot=step.World_StanceFoot;
+    result.World_MovingFoot=step.World_MovingFoot;
+    result.World_Waist=step.World_Waist;
+    result.World_StartWaist=step.World_StartWaist;
+    result.World_EndWaist=step.World_EndWaist;
+}
+
+inline void fromFootWithJoints(const foot_with_joints& step, candidate& result)
+{
+    result.joints.assign(step.joints);
+    result.start_joints.assign(step.start_joints);
+    result.end_joints.assign(step.end_joints);
+    result.World_StanceFoot=step.World_StanceFoot;
+    result.World_MovingFoot=step.World_MovingFoot;
+    result.World_Waist=step.World_Waist;
+    result.World_StartWaist=step.World_StartWaist;
+    result.World_EndWaist=step.World_EndWaist;
+}
+
+inline void toList(const candidate_store& store, std::list<foot_with_joints>& steps)
+{
+    steps.clear();
+    for (auto const& step:store)
+    {
+        steps.emplace_back();
+        toFootWithJoints(step,steps.back());
+    }
+}
+
+}
+#endif // CANDIDATE_STORE_H
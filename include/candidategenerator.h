@@ -0,0 +1,70 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef CANDIDATEGENERATOR_H
+#define CANDIDATEGENERATOR_H
+#include <list>
+#include <vector>
+#include <kdl/frames.hpp>
+#include "data_types.h"
+
+namespace planner
+{
+
+/**
+ * Lazy sweep of the yaw angles on the selected normals of the affordances, built on the world frame cache.
+ * Before a frame is built the normal is tested against the distance from the stance foot and every yaw against
+ * the yaw relative to the stance foot and the plane raster, so only the reachable candidates are instantiated.
+ */
+class candidateGenerator
+{
+public:
+    candidateGenerator();
+    // the angles min_angle, min_angle+angle_step, ... up to max_angle
+    void setSweep(double min_angle, double max_angle, double angle_step);
+    // a zero limit disables the test
+    void setReach(double max_distance, double max_yaw);
+    // a sole of zero size disables the check on the plane rasters
+    void setFoot(double length, double width);
+    // the frames of the selected normals must be in the world frame caches of the affordances
+    void reset(const std::list<polygon_with_normals>& affordances, const KDL::Frame& World_Camera, const KDL::Frame& World_StanceFoot);
+    // false when the sweep is over
+    bool next(KDL::Frame& World_MovingFoot);
+    
+    inline unsigned long getUnreachable() const {return unreachable;}
+    inline unsigned long getNotFitting() const {return not_fitting;}
+    
+private:
+    void nextNormal();
+    
+    std::vector<double> angles, cosines, sines;
+    double max_distance, cos_max_yaw;
+    double foot_length, foot_width;
+    
+    std::list<polygon_with_normals>::const_iterator polygon, polygons_end;
+    // position in the selection of the polygon of the next normal, and next angle of the current one
+    unsigned int position, angle;
+    const KDL::Frame* World_plane_frame;
+    // x and y axes of the plane frame in the stance foot frame, and its rotation in the camera frame
+    KDL::Vector StanceFoot_plane_x, StanceFoot_plane_y;
+    KDL::Rotation Camera_plane_rotation;
+    Eigen::Vector3f Camera_point;
+    KDL::Rotation Camera_World;
+    KDL::Frame StanceFoot_World;
+    
+    unsigned long unreachable, not_fitting;
+};
+
+}
+#endif // CANDIDATEGENERATOR_H
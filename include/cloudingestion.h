@@ -0,0 +1,79 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef CLOUDINGESTION_H
+#define CLOUDINGESTION_H
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <sensor_msgs/PointCloud2.h>
+#include "curvaturefilter.h"
+
+namespace planner
+{
+
+/**
+ * Keeps a subscription to the camera cloud open and preprocesses (downsampling and normals) the incoming
+ * frames in a background thread, so that a capture can use an already processed frame.
+ * Incoming messages go through a bounded ring buffer: when it is full the oldest frame is dropped.
+ */
+class cloudIngestion
+{
+public:
+    cloudIngestion(curvatureFilter* curvature_filter);
+    ~cloudIngestion();
+    // buffer_size is the number of frames waiting to be processed, with drop_frames only the newest one is processed
+    void start(ros::NodeHandle& nh, std::string topic, int buffer_size, bool drop_frames);
+    void stop();
+    bool isRunning();
+    // waits up to timeout for a frame received after the previous call and processed with the current region of interest
+    bool getFrame(spatialIndex::Ptr& index, ros::Duration timeout);
+    
+private:
+    void callback(const sensor_msgs::PointCloud2::ConstPtr& msg);
+    void worker();
+    
+    curvatureFilter* curvature_filter;
+    
+    ros::CallbackQueue queue;
+    std::unique_ptr<ros::AsyncSpinner> spinner;
+    ros::Subscriber subscriber;
+    std::thread thr;
+    bool running;
+    bool stopped;
+    
+    std::mutex mutex;
+    std::condition_variable frame_received;
+    std::condition_variable frame_processed;
+    
+    // ring buffer of the frames waiting to be processed
+    std::vector<sensor_msgs::PointCloud2::ConstPtr> buffer;
+    unsigned int buffer_head;
+    unsigned int buffer_count;
+    bool drop_frames;
+    unsigned long dropped;
+    
+    // last processed frame
+    spatialIndex::Ptr processed_index;
+    ros::Time processed_stamp;
+    unsigned int processed_roi_version;
+    ros::Time consumed_stamp;
+};
+
+}
+#endif // CLOUDINGESTION_H
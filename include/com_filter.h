@@ -16,6 +16,7 @@
 #define COM_FILTER_H
 
 #include <data_types.h>
+#include "candidate_store.h"
 #include "kinematics_utilities.h"
 #include <list>
 
@@ -23,21 +24,23 @@ class com_filter
 {
 public:
     com_filter(std::string robot_name_);
-    bool filter(std::list<planner::foot_with_joints> &data);
+    // replaces every candidate with its statically stable configurations of the waist
+    bool filter(planner::candidate_store &data);
     void setWorld_StanceFoot(const KDL::Frame& World_StanceFoot);
     void setLeftRightFoot(bool left);
     void setZeroWaistHeight ( double hip_height );
     std::vector<std::string> getJointOrder();
 
 private:
-    bool thread_com_filter(std::list< planner::foot_with_joints >& data, int num_threads);
-    bool internal_filter_first(std::list<planner::foot_with_joints> &data, KDL::Frame StanceFoot_World,
-                KDL::Frame World_StanceFoot,std::list<planner::foot_with_joints>& temp_list,
+    bool thread_com_filter(planner::candidate_store& data, int num_threads);
+    // the candidates of data in [begin,end) are expanded in result
+    bool internal_filter_first(const planner::candidate_store &data, unsigned int begin, unsigned int end, KDL::Frame StanceFoot_World,
+                KDL::Frame World_StanceFoot,planner::candidate_store& result,
                 chain_and_solvers* current_stance_chain_and_solver, chain_and_solvers* current_moving_chain_and_solver,
                 double desired_hip_height
                );
-    bool internal_filter_second(std::list<planner::foot_with_joints> &data, KDL::Frame StanceFoot_World,
-                               KDL::Frame World_StanceFoot,std::list<planner::foot_with_joints>& temp_list,
+    bool internal_filter_second(const planner::candidate_store &data, unsigned int begin, unsigned int end, KDL::Frame StanceFoot_World,
+                               KDL::Frame World_StanceFoot,planner::candidate_store& result,
                                chain_and_solvers* current_stance_chain_and_solver, chain_and_solvers* current_moving_chain_and_solver,
                                double desired_hip_height
     );
@@ -56,6 +59,8 @@ private:
     double desired_hip_height;
     bool left;
     std::vector< std::string > current_chain_names;
+    // outputs of the threads, kept between the planning cycles
+    std::vector<planner::candidate_store> thread_results;
 };
 
 #endif // COM_FILTER_H
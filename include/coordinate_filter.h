@@ -18,6 +18,7 @@
 
 #include <kdl/frames.hpp>
 #include "data_types.h"
+#include "point_predicates.h"
 #include <list>
 
 using namespace planner;
@@ -30,10 +31,15 @@ public:
     void filter_borders(std::list<polygon_with_normals>& data, bool left);
     void filter_points(std::list<polygon_with_normals>& data, bool left);
     void set_stance_foot(KDL::Frame StanceFoot_Camera);
+    // per point test of filter_points, to be fused with the other filters
+    coordinate_predicate get_predicate(bool left);
+    // the same test on points in another frame, e.g. the world frame cache of the polygons
+    coordinate_predicate get_predicate(bool left, const KDL::Frame& StanceFoot_Points);
     
 private:
+    void update_bounds(bool left);
     bool border_is_in_bounds(pcl::PointCloud<pcl::PointXYZ>::Ptr border);
-    bool point_is_in_bounds(pcl::PointXYZRGBNormal& point);
+    bool point_is_in_bounds(float x, float y, float z);
 
     double multiplier_default;
     double multiplier_axis;
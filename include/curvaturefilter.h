@@ -15,20 +15,50 @@
 #ifndef CURVATUREFILTER_H
 #define CURVATUREFILTER_H
 #include <vector>
+#include <mutex>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 #include "ros_publisher.h"
+#include "voxeldownsampler.h"
+#include "spatialindex.h"
+#include "planemap.h"
 
 namespace planner
 {
 
+enum clustering_engines
+{
+    CONDITIONAL_EUCLIDEAN_CLUSTERING=0,
+    VOXEL_ADJACENCY_CLUSTERING=1
+};
+
+enum normal_engines
+{
+    RADIUS_SEARCH_NORMALS=0,
+    VOXEL_COVARIANCE_NORMALS=1
+};
+
 class curvatureFilter
 {
 public:
+    curvatureFilter();
     std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  filterByCurvature(ros_publisher* publish,pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr);
+    // same as above, on a capture already preprocessed
+    std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  filterByCurvature(ros_publisher* publish,spatialIndex::Ptr index);
+    // downsampling and normal estimation, it can run on a different thread than filterByCurvature
+    // roi_version (if given) is set to the version of the region of interest used for this capture
+    spatialIndex::Ptr preprocess(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr, unsigned int* roi_version=NULL);
     void setParams(double curvature_threshold_,double voxel_size_, double normal_radius_, int min_cluster_size_, double cluster_tolerance_);
+    // only the points inside this sphere (camera frame) are processed, a radius of 0 disables it
+    void setRegionOfInterest(const Eigen::Vector3f& Camera_center, double radius);
+    // incremented every time the region of interest changes
+    unsigned int getRegionOfInterestVersion();
+    // spatial index (cloud, tree and clusters) of the last capture
+    spatialIndex::Ptr getSpatialIndex();
+    // points on planes of the map that did not change are not clustered again, NULL disables it
+    void setPlaneMap(planeMap* plane_map, const Eigen::Affine3f& World_Camera);
 private:
-    // normal estimator radius
+    // points with a higher curvature are not clustered (0 disables it)
     double curvature_threshold_;
     
     // downsample
@@ -42,6 +72,43 @@ private:
     
     // euclidean cluster tolerance
     double cluster_tolerance_;
+    
+    // number of threads used for the normal estimation (0 means one per core, 1 means serial)
+    int normal_threads_;
+    
+    // number of threads used for the downsampling (0 means one per core, 1 means serial)
+    int downsample_threads_;
+    
+    // one of normal_engines, used when the cloud is not organized
+    int normal_engine_;
+    
+    // use integral image normals when the input cloud is organized (0 disables it)
+    int organized_normals_;
+    
+    // integral image normal estimator parameters
+    double integral_max_depth_change_;
+    double integral_smoothing_size_;
+    
+    // one of clustering_engines
+    int clustering_engine_;
+    
+    // points farther than this from the camera are discarded (0 keeps all of them)
+    double max_range_;
+    
+    voxelDownsampler downsampler;
+    // protects the downsampler and the region of interest
+    std::mutex preprocess_mutex;
+    Eigen::Vector3f roi_center;
+    double roi_radius;
+    unsigned int roi_version;
+    spatialIndex::Ptr current_index;
+    planeMap* plane_map;
+    Eigen::Affine3f World_Camera;
+    
+    spatialIndex::Ptr computeCloudWithNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr);
+    spatialIndex::Ptr computeOrganizedCloudWithNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr);
+    void computeNormals(spatialIndex& index);
+    void conditionalClustering(spatialIndex& index, std::vector<pcl::PointIndices>& cluster_indices, const std::vector<bool>* mask=NULL);
 };
 
 
@@ -19,15 +19,48 @@
 #include <kdl/jntarray.hpp>
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
+#include "normal_points.h"
+#include "planeraster.h"
+#include <Eigen/Geometry>
 
 namespace planner
 {
 
+// world frame copy of the normals of a polygon, computed once per capture and shared by all the copies of the polygon
+struct world_frame_cache
+{
+    typedef boost::shared_ptr<world_frame_cache> Ptr;
+    
+    // camera pose the cache was built with
+    KDL::Frame World_Camera;
+    normal_points normals;
+    // frames built on the normals (before the yaw rotation), valid for the desired direction they were built with
+    std::vector<KDL::Frame> frames;
+    std::vector<unsigned char> frame_ready;
+    KDL::Vector frames_direction;
+};
+
 struct polygon_with_normals
 {
     pcl::PointCloud<pcl::PointXYZ>::Ptr border;
-    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr normals;
+    // normals of the capture, shared by all the copies of the polygon and never modified by the filters
+    normal_points::Ptr normals;
+    // indices of the normals still accepted by the filters of the current step
+    std::vector<unsigned int> selection;
     pcl::PointXYZRGBNormal average_normal;
+    // plane raster with the clearance from the border, used to check where the foot fits
+    planeRaster::Ptr raster;
+    // world frame box of the border and position in the affordance index of its capture (-1 if not indexed)
+    Eigen::AlignedBox3f world_box;
+    int index_id=-1;
+    world_frame_cache::Ptr world;
+    
+    inline void selectAll()
+    {
+        selection.resize(normals->size());
+        for (unsigned int i=0; i<selection.size(); i++)
+            selection[i]=i;
+    }
 };  
   
 typedef struct
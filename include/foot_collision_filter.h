@@ -17,6 +17,7 @@
 
 #include <kdl/frames.hpp>
 #include "data_types.h"
+#include "point_predicates.h"
 #include <list>
 
 using namespace planner;
@@ -27,9 +28,13 @@ public:
     foot_collision_filter(double h_=0.30, double l_=0.15);
     void filter_points(std::list<polygon_with_normals>& data, bool left);
     void set_stance_foot(KDL::Frame StanceFoot_Camera_);
+    // per point test of filter_points, to be fused with the other filters
+    foot_collision_predicate get_predicate(bool left);
+    // the same test on points in another frame, e.g. the world frame cache of the polygons
+    foot_collision_predicate get_predicate(bool left, const KDL::Frame& StanceFoot_Points);
     
 private:
-    bool point_is_in_bounds(pcl::PointXYZRGBNormal& point);
+    bool point_is_in_bounds(float x, float y, float z);
 
     double default_h,default_l,l,h;
     KDL::Frame StanceFoot_Camera;
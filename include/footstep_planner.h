@@ -29,6 +29,9 @@
 #include "coordinate_filter.h"
 #include "foot_collision_filter.h"
 #include "tilt_filter.h"
+#include "polygonbvh.h"
+#include "candidategenerator.h"
+#include "candidate_store.h"
 #include "ros_publisher.h"
 #include <kdl/jntarray.hpp>
 #include <kdl/tree.hpp>
@@ -58,22 +61,39 @@ private:
     //World frame
     //bool centroid_is_reachable(KDL::Frame World_MovingFoot, KDL::JntArray& jnt_pos);
             
-    void generate_frames_from_normals(std::list< polygon_with_normals >const& affordances, std::list< foot_with_joints >& steps);
+    void generate_frames_from_normals(std::list< polygon_with_normals >const& affordances, candidate_store& steps);
     
     void geometric_filtering(std::list< polygon_with_normals >& affordances, bool left);
     
-    void kinematic_filtering(std::list<foot_with_joints>& steps, bool left);
+    // drops the affordances whose world box is out of the stance foot window of the coordinate filters
+    void index_filtering(std::list< polygon_with_normals >& affordances, bool left);
     
-    void dynamic_filtering(std::list<foot_with_joints>& steps, bool left);
+    void cache_world_frame(polygon_with_normals& polygon);
+    
+    void kinematic_filtering(candidate_store& steps, bool left);
+    
+    void dynamic_filtering(candidate_store& steps, bool left);
     
     tilt_filter* filter_by_tilt;
     std::vector<coordinate_filter*> filter_by_coordinates;
     foot_collision_filter filter_to_avoid_foot;
+    polygonBVH affordance_index;
+    std::vector<bool> index_candidates;
     
     KDL::Vector World_CurrentDirection;
     std::vector< std::string > last_used_joint_names;
     
     double min_angle,max_angle,angle_step;
+    // sole rectangle, checked against the plane rasters before the kinematic filter
+    double foot_length,foot_width;
+    // normals of a polygon whose world frames are not cached yet
+    std::vector<unsigned int> missing_frames;
+    // candidates farther than max_step_distance or turned more than max_step_yaw from the stance foot are not generated, 0 disables a test;
+    // the distance defaults to the reach of the stretched legs, the yaw is not checked by default
+    double max_step_distance,max_step_yaw;
+    candidateGenerator candidates;
+    // the candidate steps of the current planning cycle
+    candidate_store candidate_steps;
     
     ros_publisher* ros_pub;
     int color_filtered;
@@ -98,6 +118,8 @@ public:
     KDL::Frame World_Waist;
     
     void setWorldTransform(KDL::Frame transform);
+    // world frame boxes and normals of the affordances of a capture, indexed and cached once for all the steps planned on them
+    void indexAffordances(std::list< polygon_with_normals >& affordances);
     foot_with_joints selectBestCentroid(const std::list< foot_with_joints >& centroids, bool left, int loss_function_type = 4);
     inline KDL::Frame getWorldTransform(){return World_Camera;}
     
@@ -113,6 +135,9 @@ public:
     // robot area for the footstep planner
     double feasible_area_;
     
+    //Camera link frame: sphere of radius feasible_area_ around the current stance foot
+    bool getRegionOfInterest(Eigen::Vector3f& Camera_center, double& radius);
+    
     std::list<foot_with_joints> single_check(KDL::Frame left_foot, KDL::Frame right_foot, bool only_ik, bool move, bool left);
     void setCurrentStanceFoot(bool left);
 };
@@ -21,9 +21,9 @@
 #include <kdl/frames_io.hpp>
 
 #include <Eigen/Dense>
-#include <eigen_conversions/eigen_kdl.h>
-#include <Eigen/SVD>
 #include <iostream>
+#include <vector>
+#include "normal_points.h"
 
 class gram_schmidt
 {
@@ -32,18 +32,20 @@ public:
 gram_schmidt();
 virtual ~gram_schmidt();
 
+// frame on the normal: z along the normal, x along the current direction projected on the plane
 KDL::Frame createFramesFromNormal(pcl::PointXYZRGBNormal);
+// the same frames for the normals of the indices, written in frames at the same indices (frames is as long as the normals)
+// direction is in the frame of the normals, the frames are built with the batch kernels
+void createFramesFromNormals(const planner::normal_points& normals, const std::vector<unsigned int>& indices, const KDL::Vector& direction, std::vector<KDL::Frame>& frames);
 void setCurrentDirection(KDL::Vector direction);
 
 private:
-    Eigen::Vector3d proj_u(Eigen::Vector3d, Eigen::Vector3d);
     Eigen::Vector3d vd;
     bool direction_set=false;
-    KDL::Frame frame_normal;
     
-    template<typename _Matrix_Type_>
-    static _Matrix_Type_ pseudoInverse(const _Matrix_Type_ &a, double epsilon =
-    std::numeric_limits<double>::epsilon());
+    // gathered normals and axes of the batch, kept between the calls
+    std::vector<float> gathered[3];
+    std::vector<float> axes[9];
 };
 
 #endif // gram_schmidt_H
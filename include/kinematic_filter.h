@@ -23,13 +23,15 @@
 #include <kdl/chainfksolverpos_recursive.hpp>
 #include <kinematics_utilities.h>
 #include <data_types.h>
+#include "candidate_store.h"
 
 
 class kinematic_filter
 {
 public:
     kinematic_filter(std::string robot_name);
-    bool filter(std::list<planner::foot_with_joints>& data);
+    // keeps the reachable candidates, with the joints of the legs and the waist
+    bool filter(planner::candidate_store& data);
     void setWorld_StanceFoot(const KDL::Frame& World_StanceFoot);
     void setLeftRightFoot(bool left);
     std::vector< std::string > getJointOrder();
@@ -45,6 +47,8 @@ private:
     KDL::Frame StanceFoot_World;
     KDL::Frame World_StanceFoot;
     KDL::JntArray jnt_pos_in;
+    // outputs of the ik and input of the fk, reused by all the candidates
+    KDL::JntArray jnt_pos_out, stance_jnt_pos;
     std::vector< std::string > current_chain_names;
     chain_and_solvers current_chain;
 
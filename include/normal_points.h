@@ -0,0 +1,103 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef NORMAL_POINTS_H
+#define NORMAL_POINTS_H
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+namespace planner
+{
+
+/**
+ * Points with normals stored as a structure of arrays, used by the planner instead of pcl::PointXYZRGBNormal
+ * so that the filters read only the coordinates they need from contiguous memory.
+ * The colour and the curvature are optional (debug and io only): rgb and curvature are either both empty or as long
+ * as the other arrays.
+ */
+struct normal_points
+{
+    typedef boost::shared_ptr<normal_points> Ptr;
+    
+    std::vector<float> x,y,z;
+    std::vector<float> normal_x,normal_y,normal_z;
+    std::vector<float> rgb,curvature;
+    
+    inline size_t size() const {return x.size();}
+    inline bool empty() const {return x.empty();}
+    
+    inline void reserve(size_t n, bool attributes=false)
+    {
+        x.reserve(n); y.reserve(n); z.reserve(n);
+        normal_x.reserve(n); normal_y.reserve(n); normal_z.reserve(n);
+        if (attributes) {rgb.reserve(n); curvature.reserve(n);}
+    }
+    
+    inline void resize(size_t n)
+    {
+        x.resize(n); y.resize(n); z.resize(n);
+        normal_x.resize(n); normal_y.resize(n); normal_z.resize(n);
+        if (!rgb.empty()) {rgb.resize(n); curvature.resize(n);}
+    }
+    
+    inline void clear()
+    {
+        resize(0);
+        rgb.clear();
+        curvature.clear();
+    }
+    
+    inline void push_back(const pcl::PointXYZRGBNormal& p, bool attributes=false)
+    {
+        x.push_back(p.x); y.push_back(p.y); z.push_back(p.z);
+        normal_x.push_back(p.normal_x); normal_y.push_back(p.normal_y); normal_z.push_back(p.normal_z);
+        if (attributes) {rgb.push_back(p.rgb); curvature.push_back(p.curvature);}
+    }
+    
+    inline pcl::PointXYZRGBNormal at(size_t i) const
+    {
+        pcl::PointXYZRGBNormal p;
+        p.x=x[i]; p.y=y[i]; p.z=z[i];
+        p.normal_x=normal_x[i]; p.normal_y=normal_y[i]; p.normal_z=normal_z[i];
+        p.rgb=rgb.empty()?0:rgb[i];
+        p.curvature=curvature.empty()?0:curvature[i];
+        return p;
+    }
+    
+    inline Ptr makeShared() const {return Ptr(new normal_points(*this));}
+};
+
+// conversions at the PCL boundary (clustering, io and visualization)
+inline void fromPointCloud(const pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud, normal_points& points, bool attributes=false)
+{
+    points.clear();
+    points.reserve(cloud.size(),attributes);
+    for (unsigned int i=0;i<cloud.size();i++)
+        points.push_back(cloud.points[i],attributes);
+}
+
+inline void toPointCloud(const normal_points& points, pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud)
+{
+    cloud.points.resize(points.size());
+    for (unsigned int i=0;i<points.size();i++)
+        cloud.points[i]=points.at(i);
+    cloud.width=points.size();
+    cloud.height=1;
+    cloud.is_dense=true;
+}
+
+}
+#endif // NORMAL_POINTS_H
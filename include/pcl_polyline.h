@@ -0,0 +1,138 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef PCL_POLYLINE_H
+#define PCL_POLYLINE_H
+#include <iterator>
+#include <cstddef>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "psimpl.h"
+
+namespace planner
+{
+
+enum polyline_methods
+{
+    DOUGLAS_PEUCKER=0,
+    DOUGLAS_PEUCKER_N=1,
+    RADIAL_DISTANCE=2,
+    REUMANN_WITKAM=3
+};
+
+/**
+ * Read only random access iterator over the coordinates x,y,z,x,y,z,... of PCL points,
+ * so that psimpl reads them where they are instead of from a copy.
+ */
+template<typename PointT>
+class coordinate_iterator : public std::iterator<std::random_access_iterator_tag, float, std::ptrdiff_t, const float*, float>
+{
+public:
+    coordinate_iterator():points(NULL),coordinate(0){}
+    coordinate_iterator(const PointT* points, std::ptrdiff_t coordinate):points(points),coordinate(coordinate){}
+    
+    inline float operator*() const {return points[coordinate/3].data[coordinate%3];}
+    inline float operator[](std::ptrdiff_t n) const {return *(*this+n);}
+    inline coordinate_iterator& operator++() {++coordinate; return *this;}
+    inline coordinate_iterator operator++(int) {coordinate_iterator old(*this); ++coordinate; return old;}
+    inline coordinate_iterator& operator--() {--coordinate; return *this;}
+    inline coordinate_iterator operator--(int) {coordinate_iterator old(*this); --coordinate; return old;}
+    inline coordinate_iterator& operator+=(std::ptrdiff_t n) {coordinate+=n; return *this;}
+    inline coordinate_iterator& operator-=(std::ptrdiff_t n) {coordinate-=n; return *this;}
+    inline coordinate_iterator operator+(std::ptrdiff_t n) const {return coordinate_iterator(points,coordinate+n);}
+    inline coordinate_iterator operator-(std::ptrdiff_t n) const {return coordinate_iterator(points,coordinate-n);}
+    inline std::ptrdiff_t operator-(const coordinate_iterator& other) const {return coordinate-other.coordinate;}
+    inline bool operator==(const coordinate_iterator& other) const {return coordinate==other.coordinate;}
+    inline bool operator!=(const coordinate_iterator& other) const {return coordinate!=other.coordinate;}
+    inline bool operator<(const coordinate_iterator& other) const {return coordinate<other.coordinate;}
+    inline bool operator>(const coordinate_iterator& other) const {return coordinate>other.coordinate;}
+    inline bool operator<=(const coordinate_iterator& other) const {return coordinate<=other.coordinate;}
+    inline bool operator>=(const coordinate_iterator& other) const {return coordinate>=other.coordinate;}
+    
+private:
+    const PointT* points;
+    std::ptrdiff_t coordinate;
+};
+
+template<typename PointT>
+inline coordinate_iterator<PointT> coordinates_begin(const pcl::PointCloud<PointT>& cloud)
+{
+    return coordinate_iterator<PointT>(cloud.points.empty()?NULL:&cloud.points[0],0);
+}
+
+template<typename PointT>
+inline coordinate_iterator<PointT> coordinates_end(const pcl::PointCloud<PointT>& cloud)
+{
+    return coordinate_iterator<PointT>(cloud.points.empty()?NULL:&cloud.points[0],3*cloud.points.size());
+}
+
+/**
+ * Output iterator that groups the coordinates written by psimpl in PointXYZ appended to a cloud.
+ */
+class point_inserter : public std::iterator<std::output_iterator_tag, void, void, void, void>
+{
+public:
+    explicit point_inserter(pcl::PointCloud<pcl::PointXYZ>& cloud):cloud(&cloud),coordinate(0){}
+    
+    inline point_inserter& operator=(float value)
+    {
+        point.data[coordinate++]=value;
+        if (coordinate==3)
+        {
+            point.data[3]=1.0f;
+            cloud->points.push_back(point);
+            coordinate=0;
+        }
+        return *this;
+    }
+    inline point_inserter& operator*() {return *this;}
+    inline point_inserter& operator++() {return *this;}
+    inline point_inserter& operator++(int) {return *this;}
+    
+private:
+    pcl::PointCloud<pcl::PointXYZ>* cloud;
+    pcl::PointXYZ point;
+    int coordinate;
+};
+
+/**
+ * Simplifies the polyline of the input points (in their order) with one of polyline_methods and appends it to output.
+ * tolerance is used by all the methods but DOUGLAS_PEUCKER_N, which keeps at most count points.
+ */
+template<typename PointT>
+void simplify_polyline(const pcl::PointCloud<PointT>& input, int method, float tolerance, unsigned int count, pcl::PointCloud<pcl::PointXYZ>& output)
+{
+    coordinate_iterator<PointT> first=coordinates_begin(input), last=coordinates_end(input);
+    point_inserter result(output);
+    switch (method)
+    {
+        case DOUGLAS_PEUCKER_N:
+            psimpl::simplify_douglas_peucker_n<3>(first,last,count,result);
+            break;
+        case RADIAL_DISTANCE:
+            psimpl::simplify_radial_distance<3>(first,last,tolerance,result);
+            break;
+        case REUMANN_WITKAM:
+            psimpl::simplify_reumann_witkam<3>(first,last,tolerance,result);
+            break;
+        default:
+            psimpl::simplify_douglas_peucker<3>(first,last,tolerance,result);
+            break;
+    }
+    output.width=output.points.size();
+    output.height=1;
+}
+
+}
+#endif // PCL_POLYLINE_H
@@ -0,0 +1,100 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef PLANEMAP_H
+#define PLANEMAP_H
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <stdint.h>
+#include <Eigen/Geometry>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include "data_types.h"
+#include "spatialindex.h"
+
+namespace planner
+{
+
+/**
+ * Persistent world frame map of the planes found in the previous captures.
+ * Every capture is fused in a voxel grid carrying the normal seen in each voxel: planes whose voxels
+ * did not change are reused as they are, and only the points of changed or new regions have to be
+ * clustered and go through the border extraction again.
+ * Polygons are stored in the camera frame, so the map is cleared whenever World_Camera changes.
+ */
+class planeMap
+{
+public:
+    planeMap();
+    void setParams(double map_voxel_size_, double normal_threshold_, double change_fraction_, int min_voxel_points_);
+    void reset();
+    
+    // fuses a capture (camera frame, with normals) and tells which points have to be clustered again
+    void update(const pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud, const Eigen::Affine3f& World_Camera, std::vector<bool>& reprocess);
+    // stores the planes extracted from the reprocessed points, one polygon for each cluster of the index
+    void insertPlanes(spatialIndex& index, const std::list<polygon_with_normals>& polygons);
+    // appends the polygons of the planes that did not change in the last update
+    void appendReusedPolygons(std::list<polygon_with_normals>& polygons);
+    
+private:
+    struct map_voxel
+    {
+        // mean normal seen in the voxel when its plane was built (world frame)
+        Eigen::Vector3f normal;
+        int plane;
+    };
+    struct map_plane
+    {
+        polygon_with_normals polygon;
+        // plane normal (world frame)
+        Eigen::Vector3f normal;
+        std::vector<uint64_t> voxels;
+    };
+    struct observed_voxel
+    {
+        Eigen::Vector3f normal_sum;
+        int count;
+    };
+    
+    uint64_t key(const Eigen::Vector3f& World_point) const;
+    void removePlane(int id);
+    
+    double map_voxel_size_;
+    // minimum dot product between two normals considered the same
+    double normal_threshold_;
+    // fraction of the voxels of a plane that can change before the plane is extracted again
+    double change_fraction_;
+    // voxels with less points than this are considered empty
+    int min_voxel_points_;
+    
+    Eigen::Affine3f World_Camera;
+    bool world_camera_set;
+    
+    std::unordered_map<uint64_t,map_voxel> voxels;
+    std::map<int,map_plane> planes;
+    int next_plane_id;
+    std::vector<int> reused_planes;
+    // an update is waiting for its new planes
+    bool pending;
+    
+    // data of the last capture
+    std::unordered_map<uint64_t,observed_voxel> observed;
+    std::vector<uint64_t> point_keys;
+    std::vector<Eigen::Vector3f, Eigen::aligned_allocator<Eigen::Vector3f> > point_normals;
+};
+
+}
+#endif // PLANEMAP_H
@@ -0,0 +1,67 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef PLANERASTER_H
+#define PLANERASTER_H
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <Eigen/Core>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+namespace planner
+{
+
+/**
+ * Occupancy raster of a cluster projected on its plane (camera frame), with one empty cell of padding on every side.
+ * The distance transform gives the clearance of every cell from the border of the plane, so a foot rectangle can be
+ * tested in a few lookups whatever the size of the cluster.
+ */
+class planeRaster
+{
+public:
+    typedef boost::shared_ptr<planeRaster> Ptr;
+    
+    planeRaster();
+    // projects the cluster on its plane and fills the cells hit by a point, closing the holes left by the downsampling
+    void build(const pcl::PointCloud<pcl::PointXYZRGBNormal>& cluster, double cell_size);
+    // keeps only the biggest 8-connected blob and returns its first cell in raster order (-1 if the raster is empty)
+    int keepLargestBlob();
+    // distance of every cell from the nearest empty one, minus half a cell
+    void computeClearance();
+    // true if the foot rectangle centered in point, with its length along heading, lies on the plane
+    bool fits(const Eigen::Vector3f& point, const Eigen::Vector3f& heading, double foot_length, double foot_width) const;
+    // point of the plane at the bottom left corner of cell (x,y)
+    Eigen::Vector3f corner(int x, int y) const;
+    
+    inline bool occupied(int x, int y) const {return cells[y*width+x];}
+    inline int getWidth() const {return width;}
+    inline int getHeight() const {return height;}
+    inline const Eigen::Vector3f& getNormal() const {return normal;}
+    
+private:
+    // clearance at a point of the plane (2D coordinates), negative outside the raster
+    float clearanceAt(const Eigen::Vector2f& p) const;
+    
+    double cell_size;
+    int width, height;
+    // plane frame: normal, in-plane axes and the plane coordinates of the corner of cell (1,1)
+    Eigen::Vector3f origin, normal, u, v;
+    Eigen::Vector2f min;
+    std::vector<unsigned char> cells;
+    std::vector<float> clearance;
+};
+
+}
+#endif // PLANERASTER_H
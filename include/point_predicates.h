@@ -0,0 +1,130 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef POINT_PREDICATES_H
+#define POINT_PREDICATES_H
+#include <list>
+#include <vector>
+#include <limits>
+#include "data_types.h"
+#include "batch_kernels.h"
+
+namespace planner
+{
+
+/**
+ * Per point tests of the geometric filters, composed at compile time with all_of so that every polygon
+ * is swept once whatever the number of filters. Each predicate is built by its filter with the current
+ * stance foot / world transform, reduced to a bound on a linear function of the coordinates, and runs
+ * on the structure of arrays with the batch kernels.
+ */
+
+// linear bound on one coordinate of the point in the stance foot frame
+struct coordinate_predicate
+{
+    bool enabled;
+    // row of StanceFoot_Camera for the filtered axis
+    float plane[4];
+    float axis_min, axis_max;
+    
+    inline void batch(const normal_points& points, unsigned char* mask) const
+    {
+        if (!enabled) return;
+        linear_bound_batch(points.x.data(),points.y.data(),points.z.data(),points.size(),plane,axis_min,axis_max,mask);
+    }
+};
+
+// half plane (stance foot frame) where the moving foot does not collide with the stance foot
+struct foot_collision_predicate
+{
+    bool enabled;
+    // x-(h/l)*y-h in the stance foot frame, as a function of the camera coordinates
+    float plane[4];
+    
+    inline void batch(const normal_points& points, unsigned char* mask) const
+    {
+        if (!enabled) return;
+        linear_bound_batch(points.x.data(),points.y.data(),points.z.data(),points.size(),plane,0,std::numeric_limits<float>::infinity(),mask);
+    }
+};
+
+// tilt of the normal w.r.t. the world vertical
+struct tilt_predicate
+{
+    bool enabled;
+    // world z axis in the camera frame
+    float vertical[3];
+    float max_tilt;
+    
+    inline void batch(const normal_points& points, unsigned char* mask) const
+    {
+        // a negative threshold accepts every normal
+        if (!enabled || max_tilt<0) return;
+        cone_bound_batch(points.normal_x.data(),points.normal_y.data(),points.normal_z.data(),points.size(),vertical,max_tilt,mask);
+    }
+};
+
+// conjunction of predicates, evaluated in order and inlined in the sweep
+template<typename... Predicates> struct all_of;
+
+template<typename Predicate> struct all_of<Predicate>
+{
+    Predicate first;
+    all_of(const Predicate& first):first(first){}
+    inline void batch(const normal_points& points, unsigned char* mask) const
+    {
+        first.batch(points,mask);
+    }
+};
+
+template<typename Predicate, typename... Rest> struct all_of<Predicate,Rest...>
+{
+    Predicate first;
+    all_of<Rest...> rest;
+    all_of(const Predicate& first, const Rest&... rest):first(first),rest(rest...){}
+    inline void batch(const normal_points& points, unsigned char* mask) const
+    {
+        first.batch(points,mask);
+        rest.batch(points,mask);
+    }
+};
+
+template<typename... Predicates> inline all_of<Predicates...> make_all_of(const Predicates&... predicates)
+{
+    return all_of<Predicates...>(predicates...);
+}
+
+// keeps in the selection of every polygon the normals satisfying keep, on the camera frame normals or on the world frame cache
+// the tests run on all the normals of the polygon (contiguous), then the selection is compacted with the mask
+template<typename Predicate> void filter_points(std::list<polygon_with_normals>& data, const Predicate& keep, bool world_frame=false)
+{
+    static thread_local std::vector<unsigned char> mask;
+    for (auto& item:data)
+    {
+        const normal_points& points=world_frame?item.world->normals:*item.normals;
+        std::vector<unsigned int>& selection=item.selection;
+        mask.assign(points.size(),1);
+        keep.batch(points,mask.data());
+        unsigned int kept=0;
+        for (unsigned int i=0; i<selection.size(); i++)
+        {
+            if (mask[selection[i]])
+                selection[kept++]=selection[i];
+        }
+        selection.resize(kept);
+    }
+}
+
+}
+#endif // POINT_PREDICATES_H
@@ -0,0 +1,64 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef POLYGONBVH_H
+#define POLYGONBVH_H
+#include <vector>
+#include <Eigen/Geometry>
+
+namespace planner
+{
+
+// points p with min <= normal.p+offset <= max
+struct slab
+{
+    Eigen::Vector3f normal;
+    float offset;
+    float min, max;
+};
+
+/**
+ * Bounding volume hierarchy of the world frame boxes of the affordances of a capture, split on the median
+ * of the longest axis. A query returns the boxes that can have points in every slab: polygons out of the
+ * stance foot window are discarded without looking at their points.
+ */
+class polygonBVH
+{
+public:
+    polygonBVH();
+    void build(const std::vector<Eigen::AlignedBox3f>& boxes);
+    void clear();
+    inline bool empty() const {return nodes.empty();}
+    inline unsigned int size() const {return boxes.size();}
+    // candidates[i] is true if box i intersects all the slabs
+    void query(const std::vector<slab>& slabs, std::vector<bool>& candidates) const;
+    
+private:
+    struct node
+    {
+        Eigen::AlignedBox3f box;
+        // leaves: range of order, inner nodes: children (the left one follows its parent)
+        int first, count;
+        int right;
+    };
+    int buildNode(int first, int count);
+    static bool intersects(const Eigen::AlignedBox3f& box, const std::vector<slab>& slabs);
+    
+    std::vector<node> nodes;
+    std::vector<int> order;
+    std::vector<Eigen::AlignedBox3f> boxes;
+};
+
+}
+#endif // POLYGONBVH_H
@@ -23,6 +23,7 @@
 #include <urdf_model/joint.h>
 #include "borderextraction.h"
 #include "data_types.h"
+#include "candidate_store.h"
 
 namespace planner
 {
@@ -36,13 +37,14 @@ public:
     void publish_foot_position(KDL::Frame World_MovingFoot, int centroid_id, bool left);
     void publish_robot_joints(const KDL::JntArray& joints, std::vector< std::string > joint_names);
     void publish_normal_cloud(pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr normals,int i);
+    void publish_normal_cloud(planner::normal_points::Ptr normals,int i);
         void publish_normal_cloud(pcl::PointCloud< pcl::Normal >::Ptr normals,pcl::PointCloud< pcl::PointXYZRGB >::Ptr points,int i);
     void publish_average_normal(std::list< polygon_with_normals >& affordances);
 
     void publish_last_joints_position();
     void setRobotJoints(std::map< std::string, boost::shared_ptr< urdf::Joint > > joints_);
     void publish_starting_position(std::map< std::string, double > initial_pos);
-    void publish_filtered_frames(std::list<foot_with_joints> steps, KDL::Frame World_Camera, int color);
+    void publish_filtered_frames(const candidate_store& steps, KDL::Frame World_Camera, int color);
     
 private:
     ros::NodeHandle node;
@@ -40,6 +40,7 @@
 
 #include "footstep_planner.h"
 #include "curvaturefilter.h"
+#include "cloudingestion.h"
 #include "borderextraction.h"
 #include "ros_publisher.h"
 #include <std_msgs/String.h>
@@ -85,6 +86,10 @@ public:
     footstepPlanner footstep_planner;
     curvatureFilter curvature_filter;
     borderExtraction border_extraction;
+    planeMap plane_map;
+    // reuse the planes that did not change since the previous capture (0 disables it)
+    int use_plane_map_;
+    cloudIngestion cloud_ingestion;
     tf::Transform current_robot_transform;
 
     
@@ -41,6 +41,7 @@
 #include <pcl/filters/filter.h>
 #include <time.h>
 #include <limits.h>
+#include <random>
 
 namespace pcl
 {
@@ -63,7 +64,7 @@ namespace pcl
     typedef typename PointCloud::Ptr PointCloudPtr;
     typedef typename PointCloud::ConstPtr PointCloudConstPtr;
 
-    typedef typename Eigen::Matrix<float, Eigen::Dynamic, 1> Vector;
+    typedef Eigen::Vector3f Vector;
 
     public:
 
@@ -72,10 +73,10 @@ namespace pcl
 
       /** \brief Empty constructor. */
       SamplingSurface () : 
-        sample_ (10), seed_ (static_cast<unsigned int> (time (NULL))), ratio_ ()
+        sample_ (10), seed_ (static_cast<unsigned int> (time (NULL))), ratio_ (), min_sample (0),
+        threads_ (1), parallel_threshold_ (4096)
       {
         filter_name_ = "SamplingSurface";
-        srand (seed_);
       }
 
       /** \brief Set maximum number of samples in each grid
@@ -106,14 +107,20 @@ namespace pcl
 	return final_indices;
       }
 
-      /** \brief Set seed of random function.
+      /** \brief Sample the input without building the output cloud
+        * \param[out] output indices of the sampled points in the input cloud
+        */
+      void
+      sample (std::vector<int>& output);
+
+      /** \brief Set seed of random function. Every grid draws from its own generator seeded with it,
+        * so the same seed gives the same samples whatever the number of threads.
         * \param[in] seed the input seed
         */
       inline void
       setSeed (unsigned int seed)
       {
         seed_ = seed;
-        srand (seed_);
       }
 
       /** \brief Get the value of the internal \a seed parameter. */
@@ -139,6 +146,17 @@ namespace pcl
         return ratio_;
       }
 
+      /** \brief Set the number of threads used to partition the input
+        * \param[in] threads maximum number of threads
+        * \param[in] parallel_threshold minimum number of points of a grid whose halves are partitioned in parallel
+        */
+      inline void
+      setThreads (int threads, unsigned int parallel_threshold = 4096)
+      {
+        threads_ = threads > 1 ? threads : 1;
+        parallel_threshold_ = parallel_threshold;
+      }
+
     protected:
 
       /** \brief Maximum number of samples in each grid. */
@@ -158,6 +176,8 @@ namespace pcl
 
       std::vector<int> final_indices;
     int min_sample;
+    int threads_;
+    unsigned int parallel_threshold_;
     
       /** \brief @b CompareDim is a comparator object for sorting across a specific dimenstion (i,.e X, Y or Z)
        */
@@ -187,13 +207,14 @@ namespace pcl
         }
       };
 
-      /** \brief Finds the max and min values in each dimension
+      /** \brief Finds the max and min values in each dimension, in a single pass
         * \param[in] cloud the input cloud 
+        * \param[in] indices the points of the cloud to consider
         * \param[out] max_vec the max value vector
         * \param[out] min_vec the min value vector
         */
       void 
-      findXYZMaxMin (const PointCloud& cloud, Vector& max_vec, Vector& min_vec);
+      findXYZMaxMin (const PointCloud& cloud, const std::vector<int>& indices, Vector& max_vec, Vector& min_vec);
 
       /** \brief Recursively partition the point cloud, stopping when each grid contains less than sample_ points
         *  Points are randomly sampled when a grid is found
@@ -203,23 +224,23 @@ namespace pcl
         * \param min_values
         * \param max_values
         * \param indices
-        * \param[out] outcloud output the resultant point cloud
+        * \param threads number of threads available for this grid
+        * \param[out] output the indices of the sampled points, in the order of the grids
         */
       void 
       partition (const PointCloud& cloud, const int first, const int last, 
-                 const Vector min_values, const Vector max_values, 
-                 std::vector<int>& indices, PointCloud& outcloud);
+                 const Vector& min_values, const Vector& max_values, 
+                 std::vector<int>& indices, int threads, std::vector<int>& output);
 
       /** \brief Randomly sample the points in each grid.
-        * \param[in] data 
         * \param[in] first
         * \param[in] last
-        * \param[out] indices 
-        * \param[out] output the resultant point cloud
+        * \param[in] indices 
+        * \param[out] output the indices of the sampled points
         */
       void 
-      samplePartition (const PointCloud& data, const int first, const int last, 
-                       std::vector<int>& indices, PointCloud& outcloud);
+      samplePartition (const int first, const int last, 
+                       const std::vector<int>& indices, std::vector<int>& output);
 
       /** \brief Returns the threshold for splitting in a given dimension.
         * \param[in] cloud the input cloud
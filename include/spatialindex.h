@@ -0,0 +1,63 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/PointIndices.h>
+#include <pcl/search/kdtree.h>
+
+namespace planner
+{
+
+/**
+ * Per-capture spatial index: the kd-tree on the downsampled cloud is built once and shared by
+ * normal estimation, clustering and border extraction. Clusters are kept as index subsets of the
+ * same cloud, so no other tree is needed for them.
+ */
+class spatialIndex
+{
+public:
+    typedef boost::shared_ptr<spatialIndex> Ptr;
+    
+    spatialIndex(pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud);
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr getCloud() const;
+    // the tree is built the first time it is asked for
+    pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr getTree();
+    
+    void setClusters(const std::vector<pcl::PointIndices>& clusters);
+    const std::vector<pcl::PointIndices>& getClusters() const;
+    // cluster of a point of the cloud, -1 if the point is not in any cluster
+    int getLabel(int point) const;
+    
+    // the clouds built from the clusters, so that a consumer can tell whether its clusters come from this index
+    void setClusterClouds(const std::vector<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr>& cluster_clouds);
+    bool hasClusterClouds(const std::vector<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr>& cluster_clouds) const;
+    
+    // radius search around a point of the cloud, returning only the points of the same cluster
+    int radiusSearchInCluster(int point, double radius, std::vector<int>& indices, std::vector<float>& squared_distances);
+    
+private:
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud;
+    pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr tree;
+    std::vector<pcl::PointIndices> clusters;
+    std::vector<int> labels;
+    std::vector<pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr> cluster_clouds;
+};
+
+}
+#endif // SPATIALINDEX_H
@@ -17,6 +17,7 @@
 
 #include <kdl/frames.hpp>
 #include "data_types.h"
+#include "point_predicates.h"
 #include <list>
 
 using namespace planner;
@@ -29,17 +30,21 @@ public:
     void filter_normals(std::list<polygon_with_normals>& data);
     void filter_single_normals(std::list<polygon_with_normals>& data);
     void set_world(KDL::Frame World_Camera_);
+    // per point test of filter_single_normals, to be fused with the other filters
+    tilt_predicate get_single_normal_predicate();
+    // the same test on normals in another frame, e.g. the world frame cache of the polygons
+    tilt_predicate get_single_normal_predicate(const KDL::Rotation& World_Points);
 
 private:
     void set_max_tilt(double max_tilt_);
     bool normal_is_in_bounds(pcl::PointXYZRGBNormal& normal);
+    bool normal_is_in_bounds(float normal_x, float normal_y, float normal_z);
 
     double max_tilt;
     double value;
     
     KDL::Frame World_Camera;
     bool world_set;
-    KDL::Vector World_point,World_normal;
 };
 
 #endif //TILT_FILTER_H
\ No newline at end of file
@@ -0,0 +1,49 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef VOXEL_KEY_H
+#define VOXEL_KEY_H
+#include <stdint.h>
+#include <cmath>
+
+namespace planner
+{
+
+// every coordinate of a voxel uses 21 bits, the grid is centered in the origin of the cloud
+// (with 1cm voxels this covers more than +-10km, so it never overflows on our scenes)
+#define VOXEL_KEY_BITS 21
+#define VOXEL_KEY_OFFSET (1<<(VOXEL_KEY_BITS-1))
+#define VOXEL_KEY_MASK ((1<<VOXEL_KEY_BITS)-1)
+
+inline int64_t voxel_coordinate(float value, double inverse_size)
+{
+    return (int64_t)floor(value*inverse_size);
+}
+
+inline uint64_t voxel_key(int64_t i, int64_t j, int64_t k)
+{
+    return  (uint64_t((i+VOXEL_KEY_OFFSET)&VOXEL_KEY_MASK)<<(2*VOXEL_KEY_BITS)) |
+            (uint64_t((j+VOXEL_KEY_OFFSET)&VOXEL_KEY_MASK)<<VOXEL_KEY_BITS) |
+             uint64_t((k+VOXEL_KEY_OFFSET)&VOXEL_KEY_MASK);
+}
+
+inline void voxel_coordinates(uint64_t key, int64_t& i, int64_t& j, int64_t& k)
+{
+    i=int64_t((key>>(2*VOXEL_KEY_BITS))&VOXEL_KEY_MASK)-VOXEL_KEY_OFFSET;
+    j=int64_t((key>>VOXEL_KEY_BITS)&VOXEL_KEY_MASK)-VOXEL_KEY_OFFSET;
+    k=int64_t(key&VOXEL_KEY_MASK)-VOXEL_KEY_OFFSET;
+}
+
+}
+#endif // VOXEL_KEY_H
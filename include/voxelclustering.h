@@ -0,0 +1,58 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef VOXELCLUSTERING_H
+#define VOXELCLUSTERING_H
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/PointIndices.h>
+
+namespace planner
+{
+
+/**
+ * Clusters an already voxelised cloud by connecting points lying in adjacent voxels (26-neighbourhood)
+ * whose normals are almost parallel. Connected components are tracked with a union-find.
+ */
+class voxelClustering
+{
+public:
+    voxelClustering();
+    void setVoxelSize(double voxel_size_);
+    void setMinClusterSize(int min_cluster_size_);
+    void setNormalThreshold(double normal_threshold_);
+    // points with a false mask are ignored
+    void segment(const pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud, std::vector<pcl::PointIndices>& cluster_indices, const std::vector<bool>* mask=NULL);
+    
+private:
+    int find(int i);
+    void merge(int a, int b);
+    
+    double voxel_size_;
+    int min_cluster_size_;
+    // minimum absolute dot product between the normals of two neighbours of the same cluster
+    double normal_threshold_;
+    
+    // voxel key -> first point in the voxel, other points of the same voxel are chained with next
+    std::unordered_map<uint64_t,int> voxels;
+    std::vector<int> next;
+    std::vector<int> parent;
+    std::vector<int> size;
+};
+
+}
+#endif // VOXELCLUSTERING_H
@@ -0,0 +1,100 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#ifndef VOXELDOWNSAMPLER_H
+#define VOXELDOWNSAMPLER_H
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+namespace planner
+{
+
+/**
+ * Perception front end: removes nans, drops points out of range and averages the remaining ones
+ * inside each voxel, all in a single sweep over the input cloud.
+ * The internal buffers are kept between two calls, so a new capture does not allocate them again.
+ */
+class voxelDownsampler
+{
+public:
+    voxelDownsampler();
+    void setLeafSize(double voxel_size_);
+    // points farther than max_range from the sensor are discarded, 0 disables the check
+    void setMaxRange(double max_range_);
+    // only points inside the sphere are kept, a radius of 0 disables the region of interest
+    void setRegionOfInterest(const Eigen::Vector3f& roi_center_, double roi_radius_);
+    // 1 bins the points serially in a hash map, otherwise keys are sorted with a parallel radix sort (0 means one thread per core)
+    void setThreads(int threads_);
+    // when normals are given (one for each input point) they are averaged too, and points with an invalid normal are discarded
+    void filter(const pcl::PointCloud<pcl::PointXYZRGB>& input, pcl::PointCloud<pcl::PointXYZRGBNormal>& output, const pcl::PointCloud<pcl::Normal>* normals=NULL);
+    // when not 0, filter also accumulates the first and second moments of the input points on a grid with this cell size
+    void setMomentsCellSize(double moments_cell_size_);
+    // normals and curvature of the output of the last filter, from the covariance of the 3x3x3 moments cells around each point;
+    // with curvature_only the normals already in the output (e.g. from the integral image) are kept
+    void computeNormals(pcl::PointCloud<pcl::PointXYZRGBNormal>& output, bool curvature_only=false);
+    
+private:
+    struct voxel_accumulator
+    {
+        double x,y,z;
+        float normal_x,normal_y,normal_z,curvature;
+        float rgb;
+        unsigned int count;
+    };
+    struct moments_accumulator
+    {
+        double sum[3];
+        // xx xy xz yy yz zz
+        double sum_squares[6];
+        unsigned int count;
+        // normal of the merged neighbourhood, computed once for all the points in the cell
+        bool solved;
+        float normal_x,normal_y,normal_z,curvature;
+    };
+    
+    bool isValid(const pcl::PointXYZRGB& p, unsigned int i, const pcl::PointCloud<pcl::Normal>* normals) const;
+    void accumulateMoments(const pcl::PointXYZRGB& p, std::unordered_map<uint64_t,int>& index, std::vector<moments_accumulator>& cells) const;
+    // plane of the points in the 3x3x3 moments cells around cell (ci,cj,ck), nan when they are less than 3
+    void solveNeighbourhood(int64_t ci, int64_t cj, int64_t ck, float& normal_x, float& normal_y, float& normal_z, float& curvature) const;
+    void filterSerial(const pcl::PointCloud<pcl::PointXYZRGB>& input, pcl::PointCloud<pcl::PointXYZRGBNormal>& output, const pcl::PointCloud<pcl::Normal>* normals);
+    void filterParallel(const pcl::PointCloud<pcl::PointXYZRGB>& input, pcl::PointCloud<pcl::PointXYZRGBNormal>& output, const pcl::PointCloud<pcl::Normal>* normals, int threads);
+    
+    double voxel_size_;
+    double max_range_;
+    Eigen::Vector3f roi_center_;
+    double roi_radius_;
+    
+    // voxel key -> position in accumulators
+    std::unordered_map<uint64_t,int> voxel_index;
+    std::vector<voxel_accumulator> accumulators;
+    
+    double moments_cell_size_;
+    std::unordered_map<uint64_t,int> moments_index;
+    std::vector<moments_accumulator> moments;
+    
+    int threads_;
+    // buffers of the parallel binning: keys and point indices (double buffered for the radix sort),
+    // first point of each voxel and the moments accumulated by each thread
+    std::vector<uint64_t> keys, keys_swap;
+    std::vector<unsigned int> points, points_swap;
+    std::vector<unsigned int> voxel_begin;
+    std::vector< std::unordered_map<uint64_t,int> > thread_moments_index;
+    std::vector< std::vector<moments_accumulator> > thread_moments;
+};
+
+}
+#endif // VOXELDOWNSAMPLER_H
@@ -0,0 +1,308 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "batch_kernels.h"
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_KERNELS_AVX2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BATCH_KERNELS_NEON
+#endif
+
+using namespace planner;
+
+// the vector versions compute the same float expressions in the same order, so the masks do not depend on the cpu
+
+static void linear_bound_scalar(const float* x, const float* y, const float* z, unsigned int begin, unsigned int n, const float plane[4], float min, float max, unsigned char* mask)
+{
+    for (unsigned int i=begin; i<n; i++)
+    {
+        float value=((plane[0]*x[i]+plane[1]*y[i])+plane[2]*z[i])+plane[3];
+        mask[i]&=(value>=min && value<=max);
+    }
+}
+
+static void cone_bound_scalar(const float* x, const float* y, const float* z, unsigned int begin, unsigned int n, const float axis[3], float min_cosine, unsigned char* mask)
+{
+    // |axis.v|/|v|<min_cosine without the square root and the division
+    float min_cosine2=min_cosine*min_cosine;
+    for (unsigned int i=begin; i<n; i++)
+    {
+        float dot=(axis[0]*x[i]+axis[1]*y[i])+axis[2]*z[i];
+        float norm2=(x[i]*x[i]+y[i]*y[i])+z[i]*z[i];
+        mask[i]&=!(dot*dot<min_cosine2*norm2);
+    }
+}
+
+// below this fraction of the squared norm of the direction its projection on the plane is not used
+#define PLANE_FRAME_PARALLEL 1e-12f
+
+static void plane_frame_scalar(const float* nx, const float* ny, const float* nz, unsigned int begin, unsigned int n, const float direction[3], float* const x_axis[3], float* const y_axis[3], float* const z_axis[3])
+{
+    float direction2=(direction[0]*direction[0]+direction[1]*direction[1])+direction[2]*direction[2];
+    for (unsigned int i=begin; i<n; i++)
+    {
+        float norm=sqrtf((nx[i]*nx[i]+ny[i]*ny[i])+nz[i]*nz[i]);
+        float zx=nx[i]/norm, zy=ny[i]/norm, zz=nz[i]/norm;
+        float dot=(zx*direction[0]+zy*direction[1])+zz*direction[2];
+        float px=direction[0]-dot*zx, py=direction[1]-dot*zy, pz=direction[2]-dot*zz;
+        float p2=(px*px+py*py)+pz*pz;
+        if (p2<=PLANE_FRAME_PARALLEL*direction2)
+        {
+            bool use_x=fabsf(zx)<0.9f;
+            float fx=use_x?1.0f:0.0f, fy=use_x?0.0f:1.0f;
+            float f_dot=zx*fx+zy*fy;
+            px=fx-f_dot*zx; py=fy-f_dot*zy; pz=0.0f-f_dot*zz;
+            p2=(px*px+py*py)+pz*pz;
+        }
+        float p_norm=sqrtf(p2);
+        px=px/p_norm; py=py/p_norm; pz=pz/p_norm;
+        x_axis[0][i]=px; x_axis[1][i]=py; x_axis[2][i]=pz;
+        y_axis[0][i]=zy*pz-zz*py; y_axis[1][i]=zz*px-zx*pz; y_axis[2][i]=zx*py-zy*px;
+        z_axis[0][i]=zx; z_axis[1][i]=zy; z_axis[2][i]=zz;
+    }
+}
+
+#ifdef BATCH_KERNELS_AVX2
+
+// for every combination of 8 failed points, the bytes to keep in the mask
+struct keep_table
+{
+    uint64_t bytes[256];
+    keep_table()
+    {
+        for (int bits=0; bits<256; bits++)
+        {
+            bytes[bits]=0;
+            for (int k=0; k<8; k++)
+                if (!(bits&(1<<k))) bytes[bits]|=uint64_t(0xff)<<(8*k);
+        }
+    }
+};
+static const keep_table keep_bytes;
+
+// clears the mask of the points whose lane is set in fail, without branches
+__attribute__((target("avx2")))
+static inline void clear_mask_avx2(__m256 fail, unsigned char* mask)
+{
+    uint64_t bytes;
+    memcpy(&bytes,mask,8);
+    bytes&=keep_bytes.bytes[_mm256_movemask_ps(fail)];
+    memcpy(mask,&bytes,8);
+}
+
+__attribute__((target("avx2")))
+static void linear_bound_avx2(const float* x, const float* y, const float* z, unsigned int n, const float plane[4], float min, float max, unsigned char* mask)
+{
+    const __m256 a=_mm256_set1_ps(plane[0]), b=_mm256_set1_ps(plane[1]), c=_mm256_set1_ps(plane[2]), d=_mm256_set1_ps(plane[3]);
+    const __m256 low=_mm256_set1_ps(min), high=_mm256_set1_ps(max);
+    unsigned int i=0;
+    for (; i+8<=n; i+=8)
+    {
+        __m256 value=_mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a,_mm256_loadu_ps(x+i)),_mm256_mul_ps(b,_mm256_loadu_ps(y+i))),_mm256_mul_ps(c,_mm256_loadu_ps(z+i))),d);
+        // not (value>=min and value<=max), true on nan as in the scalar version
+        __m256 fail=_mm256_or_ps(_mm256_cmp_ps(value,low,_CMP_NGE_UQ),_mm256_cmp_ps(value,high,_CMP_NLE_UQ));
+        clear_mask_avx2(fail,mask+i);
+    }
+    linear_bound_scalar(x,y,z,i,n,plane,min,max,mask);
+}
+
+__attribute__((target("avx2")))
+static void cone_bound_avx2(const float* x, const float* y, const float* z, unsigned int n, const float axis[3], float min_cosine, unsigned char* mask)
+{
+    const __m256 a=_mm256_set1_ps(axis[0]), b=_mm256_set1_ps(axis[1]), c=_mm256_set1_ps(axis[2]);
+    const __m256 min_cosine2=_mm256_set1_ps(min_cosine*min_cosine);
+    unsigned int i=0;
+    for (; i+8<=n; i+=8)
+    {
+        __m256 vx=_mm256_loadu_ps(x+i), vy=_mm256_loadu_ps(y+i), vz=_mm256_loadu_ps(z+i);
+        __m256 dot=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a,vx),_mm256_mul_ps(b,vy)),_mm256_mul_ps(c,vz));
+        __m256 norm2=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx,vx),_mm256_mul_ps(vy,vy)),_mm256_mul_ps(vz,vz));
+        __m256 fail=_mm256_cmp_ps(_mm256_mul_ps(dot,dot),_mm256_mul_ps(min_cosine2,norm2),_CMP_LT_OQ);
+        clear_mask_avx2(fail,mask+i);
+    }
+    cone_bound_scalar(x,y,z,i,n,axis,min_cosine,mask);
+}
+
+__attribute__((target("avx2")))
+static void plane_frame_avx2(const float* nx, const float* ny, const float* nz, unsigned int n, const float direction[3], float* const x_axis[3], float* const y_axis[3], float* const z_axis[3])
+{
+    const __m256 dx=_mm256_set1_ps(direction[0]), dy=_mm256_set1_ps(direction[1]), dz=_mm256_set1_ps(direction[2]);
+    const __m256 parallel=_mm256_set1_ps(PLANE_FRAME_PARALLEL*((direction[0]*direction[0]+direction[1]*direction[1])+direction[2]*direction[2]));
+    const __m256 one=_mm256_set1_ps(1.0f), zero=_mm256_setzero_ps(), sign=_mm256_set1_ps(-0.0f), limit=_mm256_set1_ps(0.9f);
+    unsigned int i=0;
+    for (; i+8<=n; i+=8)
+    {
+        __m256 zx=_mm256_loadu_ps(nx+i), zy=_mm256_loadu_ps(ny+i), zz=_mm256_loadu_ps(nz+i);
+        __m256 norm=_mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(zx,zx),_mm256_mul_ps(zy,zy)),_mm256_mul_ps(zz,zz)));
+        zx=_mm256_div_ps(zx,norm); zy=_mm256_div_ps(zy,norm); zz=_mm256_div_ps(zz,norm);
+        __m256 dot=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(zx,dx),_mm256_mul_ps(zy,dy)),_mm256_mul_ps(zz,dz));
+        __m256 px=_mm256_sub_ps(dx,_mm256_mul_ps(dot,zx)), py=_mm256_sub_ps(dy,_mm256_mul_ps(dot,zy)), pz=_mm256_sub_ps(dz,_mm256_mul_ps(dot,zz));
+        __m256 p2=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,px),_mm256_mul_ps(py,py)),_mm256_mul_ps(pz,pz));
+        __m256 degenerate=_mm256_cmp_ps(p2,parallel,_CMP_LE_OQ);
+        if (_mm256_movemask_ps(degenerate))
+        {
+            __m256 use_x=_mm256_cmp_ps(_mm256_andnot_ps(sign,zx),limit,_CMP_LT_OQ);
+            __m256 fx=_mm256_blendv_ps(zero,one,use_x), fy=_mm256_blendv_ps(one,zero,use_x);
+            __m256 f_dot=_mm256_add_ps(_mm256_mul_ps(zx,fx),_mm256_mul_ps(zy,fy));
+            px=_mm256_blendv_ps(px,_mm256_sub_ps(fx,_mm256_mul_ps(f_dot,zx)),degenerate);
+            py=_mm256_blendv_ps(py,_mm256_sub_ps(fy,_mm256_mul_ps(f_dot,zy)),degenerate);
+            pz=_mm256_blendv_ps(pz,_mm256_sub_ps(zero,_mm256_mul_ps(f_dot,zz)),degenerate);
+            p2=_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,px),_mm256_mul_ps(py,py)),_mm256_mul_ps(pz,pz));
+        }
+        __m256 p_norm=_mm256_sqrt_ps(p2);
+        px=_mm256_div_ps(px,p_norm); py=_mm256_div_ps(py,p_norm); pz=_mm256_div_ps(pz,p_norm);
+        _mm256_storeu_ps(x_axis[0]+i,px); _mm256_storeu_ps(x_axis[1]+i,py); _mm256_storeu_ps(x_axis[2]+i,pz);
+        _mm256_storeu_ps(y_axis[0]+i,_mm256_sub_ps(_mm256_mul_ps(zy,pz),_mm256_mul_ps(zz,py)));
+        _mm256_storeu_ps(y_axis[1]+i,_mm256_sub_ps(_mm256_mul_ps(zz,px),_mm256_mul_ps(zx,pz)));
+        _mm256_storeu_ps(y_axis[2]+i,_mm256_sub_ps(_mm256_mul_ps(zx,py),_mm256_mul_ps(zy,px)));
+        _mm256_storeu_ps(z_axis[0]+i,zx); _mm256_storeu_ps(z_axis[1]+i,zy); _mm256_storeu_ps(z_axis[2]+i,zz);
+    }
+    plane_frame_scalar(nx,ny,nz,i,n,direction,x_axis,y_axis,z_axis);
+}
+
+static bool has_avx2()
+{
+    static const bool avx2=__builtin_cpu_supports("avx2");
+    return avx2;
+}
+
+#endif
+
+#ifdef BATCH_KERNELS_NEON
+
+static inline void clear_mask_neon(uint32x4_t fail, unsigned char* mask)
+{
+    // one byte for each lane, 0 where the point failed
+    uint8x8_t keep=vmvn_u8(vmovn_u16(vcombine_u16(vmovn_u32(fail),vdup_n_u16(0))));
+    uint32_t bytes, lanes=vget_lane_u32(vreinterpret_u32_u8(keep),0);
+    memcpy(&bytes,mask,4);
+    bytes&=lanes;
+    memcpy(mask,&bytes,4);
+}
+
+static void linear_bound_neon(const float* x, const float* y, const float* z, unsigned int n, const float plane[4], float min, float max, unsigned char* mask)
+{
+    const float32x4_t a=vdupq_n_f32(plane[0]), b=vdupq_n_f32(plane[1]), c=vdupq_n_f32(plane[2]), d=vdupq_n_f32(plane[3]);
+    const float32x4_t low=vdupq_n_f32(min), high=vdupq_n_f32(max);
+    unsigned int i=0;
+    for (; i+4<=n; i+=4)
+    {
+        float32x4_t value=vaddq_f32(vaddq_f32(vaddq_f32(vmulq_f32(a,vld1q_f32(x+i)),vmulq_f32(b,vld1q_f32(y+i))),vmulq_f32(c,vld1q_f32(z+i))),d);
+        uint32x4_t inside=vandq_u32(vcgeq_f32(value,low),vcleq_f32(value,high));
+        clear_mask_neon(vmvnq_u32(inside),mask+i);
+    }
+    linear_bound_scalar(x,y,z,i,n,plane,min,max,mask);
+}
+
+static void cone_bound_neon(const float* x, const float* y, const float* z, unsigned int n, const float axis[3], float min_cosine, unsigned char* mask)
+{
+    const float32x4_t a=vdupq_n_f32(axis[0]), b=vdupq_n_f32(axis[1]), c=vdupq_n_f32(axis[2]);
+    const float32x4_t min_cosine2=vdupq_n_f32(min_cosine*min_cosine);
+    unsigned int i=0;
+    for (; i+4<=n; i+=4)
+    {
+        float32x4_t vx=vld1q_f32(x+i), vy=vld1q_f32(y+i), vz=vld1q_f32(z+i);
+        float32x4_t dot=vaddq_f32(vaddq_f32(vmulq_f32(a,vx),vmulq_f32(b,vy)),vmulq_f32(c,vz));
+        float32x4_t norm2=vaddq_f32(vaddq_f32(vmulq_f32(vx,vx),vmulq_f32(vy,vy)),vmulq_f32(vz,vz));
+        clear_mask_neon(vcltq_f32(vmulq_f32(dot,dot),vmulq_f32(min_cosine2,norm2)),mask+i);
+    }
+    cone_bound_scalar(x,y,z,i,n,axis,min_cosine,mask);
+}
+
+// division, square root and horizontal max are only in the 64 bit NEON
+#ifdef __aarch64__
+#define BATCH_KERNELS_NEON_FRAMES
+static void plane_frame_neon(const float* nx, const float* ny, const float* nz, unsigned int n, const float direction[3], float* const x_axis[3], float* const y_axis[3], float* const z_axis[3])
+{
+    const float32x4_t dx=vdupq_n_f32(direction[0]), dy=vdupq_n_f32(direction[1]), dz=vdupq_n_f32(direction[2]);
+    const float32x4_t parallel=vdupq_n_f32(PLANE_FRAME_PARALLEL*((direction[0]*direction[0]+direction[1]*direction[1])+direction[2]*direction[2]));
+    const float32x4_t one=vdupq_n_f32(1.0f), zero=vdupq_n_f32(0.0f), limit=vdupq_n_f32(0.9f);
+    unsigned int i=0;
+    for (; i+4<=n; i+=4)
+    {
+        float32x4_t zx=vld1q_f32(nx+i), zy=vld1q_f32(ny+i), zz=vld1q_f32(nz+i);
+        float32x4_t norm=vsqrtq_f32(vaddq_f32(vaddq_f32(vmulq_f32(zx,zx),vmulq_f32(zy,zy)),vmulq_f32(zz,zz)));
+        zx=vdivq_f32(zx,norm); zy=vdivq_f32(zy,norm); zz=vdivq_f32(zz,norm);
+        float32x4_t dot=vaddq_f32(vaddq_f32(vmulq_f32(zx,dx),vmulq_f32(zy,dy)),vmulq_f32(zz,dz));
+        float32x4_t px=vsubq_f32(dx,vmulq_f32(dot,zx)), py=vsubq_f32(dy,vmulq_f32(dot,zy)), pz=vsubq_f32(dz,vmulq_f32(dot,zz));
+        float32x4_t p2=vaddq_f32(vaddq_f32(vmulq_f32(px,px),vmulq_f32(py,py)),vmulq_f32(pz,pz));
+        uint32x4_t degenerate=vcleq_f32(p2,parallel);
+        if (vmaxvq_u32(degenerate))
+        {
+            uint32x4_t use_x=vcltq_f32(vabsq_f32(zx),limit);
+            float32x4_t fx=vbslq_f32(use_x,one,zero), fy=vbslq_f32(use_x,zero,one);
+            float32x4_t f_dot=vaddq_f32(vmulq_f32(zx,fx),vmulq_f32(zy,fy));
+            px=vbslq_f32(degenerate,vsubq_f32(fx,vmulq_f32(f_dot,zx)),px);
+            py=vbslq_f32(degenerate,vsubq_f32(fy,vmulq_f32(f_dot,zy)),py);
+            pz=vbslq_f32(degenerate,vsubq_f32(zero,vmulq_f32(f_dot,zz)),pz);
+            p2=vaddq_f32(vaddq_f32(vmulq_f32(px,px),vmulq_f32(py,py)),vmulq_f32(pz,pz));
+        }
+        float32x4_t p_norm=vsqrtq_f32(p2);
+        px=vdivq_f32(px,p_norm); py=vdivq_f32(py,p_norm); pz=vdivq_f32(pz,p_norm);
+        vst1q_f32(x_axis[0]+i,px); vst1q_f32(x_axis[1]+i,py); vst1q_f32(x_axis[2]+i,pz);
+        vst1q_f32(y_axis[0]+i,vsubq_f32(vmulq_f32(zy,pz),vmulq_f32(zz,py)));
+        vst1q_f32(y_axis[1]+i,vsubq_f32(vmulq_f32(zz,px),vmulq_f32(zx,pz)));
+        vst1q_f32(y_axis[2]+i,vsubq_f32(vmulq_f32(zx,py),vmulq_f32(zy,px)));
+        vst1q_f32(z_axis[0]+i,zx); vst1q_f32(z_axis[1]+i,zy); vst1q_f32(z_axis[2]+i,zz);
+    }
+    plane_frame_scalar(nx,ny,nz,i,n,direction,x_axis,y_axis,z_axis);
+}
+#endif
+
+#endif
+
+void planner::linear_bound_batch(const float* x, const float* y, const float* z, unsigned int n, const float plane[4], float min, float max, unsigned char* mask)
+{
+#if defined(BATCH_KERNELS_AVX2)
+    if (has_avx2()) return linear_bound_avx2(x,y,z,n,plane,min,max,mask);
+#elif defined(BATCH_KERNELS_NEON)
+    return linear_bound_neon(x,y,z,n,plane,min,max,mask);
+#endif
+    linear_bound_scalar(x,y,z,0,n,plane,min,max,mask);
+}
+
+void planner::cone_bound_batch(const float* x, const float* y, const float* z, unsigned int n, const float axis[3], float min_cosine, unsigned char* mask)
+{
+#if defined(BATCH_KERNELS_AVX2)
+    if (has_avx2()) return cone_bound_avx2(x,y,z,n,axis,min_cosine,mask);
+#elif defined(BATCH_KERNELS_NEON)
+    return cone_bound_neon(x,y,z,n,axis,min_cosine,mask);
+#endif
+    cone_bound_scalar(x,y,z,0,n,axis,min_cosine,mask);
+}
+
+void planner::plane_frame_batch(const float* nx, const float* ny, const float* nz, unsigned int n, const float direction[3], float* const x_axis[3], float* const y_axis[3], float* const z_axis[3])
+{
+#if defined(BATCH_KERNELS_AVX2)
+    if (has_avx2()) return plane_frame_avx2(nx,ny,nz,n,direction,x_axis,y_axis,z_axis);
+#elif defined(BATCH_KERNELS_NEON_FRAMES)
+    return plane_frame_neon(nx,ny,nz,n,direction,x_axis,y_axis,z_axis);
+#endif
+    plane_frame_scalar(nx,ny,nz,0,n,direction,x_axis,y_axis,z_axis);
+}
+
+const char* planner::batch_kernels_isa()
+{
+#if defined(BATCH_KERNELS_AVX2)
+    if (has_avx2()) return "avx2";
+#elif defined(BATCH_KERNELS_NEON)
+    return "neon";
+#endif
+    return "scalar";
+}
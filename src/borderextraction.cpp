@@ -18,14 +18,24 @@
 #include <pcl/features/boundary.h>
 #include <pcl/features/normal_3d.h>
 #include <visualization_msgs/Marker.h>
-#include "psimpl.h"
+#include "pcl_polyline.h"
 #include "sampling_surface.hpp"
 #include <pcl/filters/sampling_surface_normal.h>
-#include <time.h>
+#include <cfloat>
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <param_manager.h>
 #include <eigen3/Eigen/src/Core/Matrix.h>
 
 using namespace planner;
 
+// neighbourhood and angle used to decide if a point lies on the border of its cluster
+#define BOUNDARY_RADIUS 0.1
+#define BOUNDARY_ANGLE (M_PI/4)
+// clusters bigger than this are split in more boundary tasks
+#define BOUNDARY_CHUNK 2048
+
 
 bool compare_2d(pcl::PointXYZ a, pcl::PointXYZ b)
 {
@@ -69,94 +79,271 @@ bool atan_compare_2d(pcl::PointXYZRGBNormal a, pcl::PointXYZRGBNormal b)
 }
 
 
-std::list< polygon_with_normals > borderExtraction::extractBorders(const std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >& clusters)
+void borderExtraction::estimateBoundaries(const pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr& cluster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border)
 {
-    std::list<  polygon_with_normals > polygons;
+    pcl::PointCloud<pcl::Boundary> boundaries;
+    pcl::BoundaryEstimation<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal, pcl::Boundary> boundEst;
 
-    if(clusters.size()==0)
+    boundEst.setInputCloud(cluster);
+    boundEst.setInputNormals(cluster); //TODO: will this work?
+    boundEst.setRadiusSearch(BOUNDARY_RADIUS);
+    boundEst.setAngleThreshold(BOUNDARY_ANGLE);
+    boundEst.setSearchMethod(pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr (new pcl::search::KdTree<pcl::PointXYZRGBNormal>));
+
+    boundEst.compute(boundaries);
+
+    for(int b = 0; b < cluster->points.size(); b++)
     {
-        std::cout<<"No clusters to process, you should call the [/filter_by_curvature] service first"<<std::endl;
-        return polygons;
+        if(boundaries[b].boundary_point < 1)
+        {
+            //not in the boundary
+        }
+        else
+        {
+            border.push_back(cluster->at(b));
+        }
     }
+}
 
-    pcl::PointXYZRGBNormal average_normal;
-    Eigen::Vector4f plane;
-    Eigen::Matrix<double,4,1> centroid;
-    float curv;
-
-    for (unsigned int i=0; i< clusters.size(); i++)
+void borderExtraction::estimateBoundaries(spatialIndex& index, int cluster, unsigned int begin, unsigned int end, pcl::PointCloud< pcl::PointXYZRGBNormal >& border)
+{
+    // same test of pcl::BoundaryEstimation, with the neighbours taken from the shared tree and restricted to the cluster
+    pcl::BoundaryEstimation<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal, pcl::Boundary> boundEst;
+    const pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud=*index.getCloud();
+    std::vector<int> nn_indices;
+    std::vector<float> nn_distances;
+    Eigen::Vector4f u = Eigen::Vector4f::Zero (), v = Eigen::Vector4f::Zero ();
+
+    const std::vector<int>& cluster_indices=index.getClusters()[cluster].indices;
+    for (unsigned int i=begin; i<end; i++)
     {
-        std::cout<<std::endl;
+        int point=cluster_indices[i];
+        if (index.radiusSearchInCluster(point,BOUNDARY_RADIUS,nn_indices,nn_distances)==0)
+            continue;
+        boundEst.getCoordinateSystemOnPlane(cloud.points[point],u,v);
+        if (boundEst.isBoundaryPoint(cloud,point,nn_indices,u,v,BOUNDARY_ANGLE))
+            border.push_back(cloud.points[point]);
+    }
+}
 
-        std::cout<<"- Size of cluster "<<i<<": "<<clusters.at(i)->size()<<std::endl;
+// runs task(0..count-1) on a pool of threads, every thread takes the next task from a shared counter
+template<typename Task>
+static void run_tasks(int threads, unsigned int count, Task task)
+{
+    std::atomic<unsigned int> next(0);
+    auto worker=[&]()
+    {
+        for (unsigned int t=next++; t<count; t=next++)
+            task(t);
+    };
+    std::vector<std::thread> pool;
+    for (int i=1; i<threads && i<(int)count; i++)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& thread:pool)
+        thread.join();
+}
 
-        pcl::PointCloud<pcl::Boundary> boundaries;
-        pcl::BoundaryEstimation<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal, pcl::Boundary> boundEst;
+borderExtraction::borderExtraction():raster_size_(0.01)
+{
+    param_manager::register_param("border_threads",border_threads_);
+    param_manager::update_param("border_threads",0);
+    param_manager::register_param("border_engine",border_engine_);
+    param_manager::update_param("border_engine",BOUNDARY_ESTIMATION_BORDERS);
+    param_manager::register_param("polyline_method",polyline_method_);
+    param_manager::update_param("polyline_method",DOUGLAS_PEUCKER);
+    param_manager::register_param("polyline_tolerance",polyline_tolerance_);
+    param_manager::update_param("polyline_tolerance",0.05);
+    param_manager::register_param("polyline_points",polyline_points_);
+    param_manager::update_param("polyline_points",20);
+    param_manager::register_param("sampler_seed",sampler_seed_);
+    param_manager::update_param("sampler_seed",0);
+}
 
-        boundEst.setInputCloud(clusters[i]);
-        boundEst.setInputNormals(clusters[i]); //TODO: will this work?
-        boundEst.setRadiusSearch(0.1);
-        boundEst.setAngleThreshold(M_PI/4);
-        boundEst.setSearchMethod(pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr (new pcl::search::KdTree<pcl::PointXYZRGBNormal>));
+void borderExtraction::setRasterSize(double raster_size_)
+{
+    this->raster_size_=raster_size_;
+}
 
-        std::cout<<"- Estimating border from cluster . . ."<<std::endl;
+void borderExtraction::traceBoundary(planeRaster& raster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border)
+{
+    // only the biggest 8-connected blob is traced
+    int start=raster.keepLargestBlob();
+    if (start<0)
+        return;
+    int W=raster.getWidth();
+    
+    // marching squares: the window with corner (x,y) covers the cells (x-1,y-1) (x,y-1) (x-1,y) (x,y)
+    // the first cell in raster order has an empty window above and on the left, so the tracing starts from its corner
+    enum {NONE,UP,DOWN,LEFT,RIGHT};
+    int start_x=start%W, start_y=start/W;
+    int x=start_x, y=start_y;
+    int previous=NONE, step=NONE;
+    do
+    {
+        int state=raster.occupied(x-1,y-1)*1+raster.occupied(x,y-1)*2+raster.occupied(x-1,y)*4+raster.occupied(x,y)*8;
+        switch (state)
+        {
+            case 1: case 5: case 13: step=UP; break;
+            case 2: case 3: case 7: step=RIGHT; break;
+            case 4: case 12: case 14: step=LEFT; break;
+            case 8: case 10: case 11: step=DOWN; break;
+            case 6: step=(previous==UP)?RIGHT:LEFT; break;
+            case 9: step=(previous==RIGHT)?DOWN:UP; break;
+            default: return; // never happens on the contour
+        }
+        // corners are kept only where the contour turns
+        if (step!=previous)
+        {
+            pcl::PointXYZRGBNormal point;
+            point.getVector3fMap()=raster.corner(x,y);
+            point.getNormalVector3fMap()=raster.getNormal();
+            border.push_back(point);
+        }
+        previous=step;
+        if (step==UP) y--;
+        else if (step==DOWN) y++;
+        else if (step==LEFT) x--;
+        else x++;
+    }
+    while (x!=start_x || y!=start_y);
+}
 
-        boundEst.compute(boundaries);
+void borderExtraction::extractPolygon(const pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr& cluster, pcl::PointCloud< pcl::PointXYZRGBNormal >& border, bool ordered, int sampler_threads, polygon_with_normals& polygon, std::ostream& log)
+{
+    log<<"- Border number of points: "<<border.size()<<std::endl;
+    polygon.border=simplifyBorder(border,ordered,log);
+    
+    // the raster engine has already built the raster of the cluster
+    if (!polygon.raster)
+    {
+        polygon.raster.reset(new planeRaster);
+        polygon.raster->build(*cluster,raster_size_);
+    }
+    polygon.raster->computeClearance();
+    
+    polygon.normals.reset(new normal_points);
+    std::vector<int> indices;
+    pcl::SamplingSurface<pcl::PointXYZRGBNormal> sampler;
+    //pcl::SamplingSurfaceNormal<pcl::PointXYZRGBNormal> sampler;
+    sampler.setSample(100);
+    sampler.setMinSample(2);
+    sampler.setRatio(0.04*3000.0/cluster->size());
+    sampler.setInputCloud(cluster);
+    sampler.setSeed(sampler_seed_);
+    sampler.setThreads(sampler_threads);
+    sampler.sample(indices);
+    
+    polygon.normals->reserve(indices.size(),true);
+    for (auto j:indices)
+    {
+        polygon.normals->push_back(cluster->at(j),true);
+    }
+    
+    pcl::PointXYZRGBNormal average_normal;
+    Eigen::Vector4f plane;
+    Eigen::Matrix<double,4,1> centroid;
+    float curv;
+    pcl::computePointNormal(*cluster,plane,curv);
+    pcl::compute3DCentroid(*cluster,centroid);
+    average_normal.x=0+centroid[0]; average_normal.y=0+centroid[1]; average_normal.z=0+centroid[2];
+    average_normal.normal_x=plane[0]; average_normal.normal_y=plane[1]; average_normal.normal_z=plane[2];
+    
+    //flipping normals w.r.t. view point
+    pcl::flipNormalTowardsViewpoint	(average_normal,0,0,0,average_normal.normal_x, average_normal.normal_y,average_normal.normal_z);
+    
+    polygon.average_normal=average_normal;
+}
 
-        pcl::PointCloud<pcl::PointXYZRGBNormal> border;
+std::list< polygon_with_normals > borderExtraction::extractBorders(const std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >& clusters, spatialIndex* index)
+{
+    std::list<  polygon_with_normals > polygons;
 
-        for(int b = 0; b < clusters[i]->points.size(); b++)
+    if(clusters.size()==0)
+    {
+        std::cout<<"No clusters to process, you should call the [/filter_by_curvature] service first"<<std::endl;
+        return polygons;
+    }
+    
+    int threads=border_threads_>0?border_threads_:std::thread::hardware_concurrency();
+    if (threads<1) threads=1;
+    bool raster=border_engine_==RASTER_BORDERS;
+    bool use_index=!raster && index && index->hasClusterClouds(clusters);
+    
+    // every cluster writes only its own slots, so the output order does not depend on the scheduling
+    unsigned int N=clusters.size();
+    std::vector<pcl::PointCloud<pcl::PointXYZRGBNormal>> borders(N);
+    std::vector<polygon_with_normals> results(N);
+    std::vector<std::ostringstream> logs(N);
+    
+    // big clusters are split in chunks of points, whose border points are concatenated in order
+    struct boundary_task
+    {
+        unsigned int cluster;
+        unsigned int begin,end;
+    };
+    std::vector<boundary_task> tasks;
+    for (unsigned int i=0; i<N; i++)
+    {
+        boundary_task task;
+        task.cluster=i;
+        task.begin=0;
+        task.end=clusters[i]->size();
+        if (!use_index)
+        {
+            tasks.push_back(task);
+            continue;
+        }
+        unsigned int size=index->getClusters()[i].indices.size();
+        for (task.begin=0; task.begin<size; task.begin+=BOUNDARY_CHUNK)
         {
-            if(boundaries[b].boundary_point < 1)
-            {
-                //not in the boundary
-            }
-            else
-            {
-                border.push_back(clusters[i]->at(b));
-            }
+            task.end=std::min<unsigned int>(task.begin+BOUNDARY_CHUNK,size);
+            tasks.push_back(task);
         }
+    }
+    std::vector<pcl::PointCloud<pcl::PointXYZRGBNormal>> chunk_borders(tasks.size());
+    
+    // the tree is built lazily, it must exist before the threads use it
+    if (use_index)
+        index->getTree();
+    
+    run_tasks(threads,tasks.size(),[&](unsigned int t)
+    {
+        if (raster)
+        {
+            results[tasks[t].cluster].raster.reset(new planeRaster);
+            results[tasks[t].cluster].raster->build(*clusters[tasks[t].cluster],raster_size_);
+            traceBoundary(*results[tasks[t].cluster].raster,chunk_borders[t]);
+        }
+        else if (use_index)
+            estimateBoundaries(*index,tasks[t].cluster,tasks[t].begin,tasks[t].end,chunk_borders[t]);
+        else
+            estimateBoundaries(clusters[tasks[t].cluster],chunk_borders[t]);
+    });
+    for (unsigned int t=0; t<tasks.size(); t++)
+        borders[tasks[t].cluster]+=chunk_borders[t];
+    
+    // with less clusters than threads the spare ones go to the sampler
+    int sampler_threads=std::max<int>(1,threads/N);
+    run_tasks(threads,N,[&](unsigned int i)
+    {
+        logs[i]<<std::endl;
+        logs[i]<<"- Size of cluster "<<i<<": "<<clusters.at(i)->size()<<std::endl;
+        logs[i]<<"- Estimating border from cluster . . ."<<std::endl;
+        extractPolygon(clusters[i],borders[i],raster,sampler_threads,results[i],logs[i]);
+    });
 
-        std::cout<<"- Border number of points: "<<border.size()<<std::endl;
-        polygon_with_normals temp;
-        temp.border=douglas_peucker_3d(border,0.05);
-	
-        pcl::PointCloud<pcl::PointXYZRGBNormal> temp_cloud;
-        pcl::PointCloud<pcl::PointXYZRGBNormal> final_cloud;
-        temp.normals=final_cloud.makeShared();
-	
-	pcl::SamplingSurface<pcl::PointXYZRGBNormal> sampler;
-        //pcl::SamplingSurfaceNormal<pcl::PointXYZRGBNormal> sampler;
-        sampler.setSample(100);
-	sampler.setMinSample(2);
-        sampler.setRatio(0.04*3000.0/clusters[i]->size());
-        sampler.setInputCloud(clusters[i]);
-        sampler.setSeed(time(NULL));
-        sampler.filter(temp_cloud);
-	auto indices=sampler.getFilteredIndices();
-
- 	for (auto j:indices)
- 	{
-	  temp.normals->push_back(clusters[i]->at(j));
- 	}
-	
-	pcl::computePointNormal(*(clusters[i]),plane,curv);
-	pcl::compute3DCentroid(*(clusters[i]),centroid);
-	average_normal.x=0+centroid[0]; average_normal.y=0+centroid[1]; average_normal.z=0+centroid[2];
-        average_normal.normal_x=plane[0]; average_normal.normal_y=plane[1]; average_normal.normal_z=plane[2];
+    for (unsigned int i=0; i<N; i++)
+    {
+        std::cout<<logs[i].str();
         
-        //flipping normals w.r.t. view point
-        pcl::flipNormalTowardsViewpoint	(average_normal,0,0,0,average_normal.normal_x, average_normal.normal_y,average_normal.normal_z);
-	
-	temp.average_normal=average_normal;
-	
-        if(!temp.border) {
+        if(!results[i].border) {
             std::cout<<"- !! Failed to Compute the polygon to approximate the Border !!"<<std::endl;
             return polygons;
         }
 
-        std::cout<<"- Polygon number of points: "<<temp.border->size()<<std::endl;
-        polygons.push_back(temp);
+        std::cout<<"- Polygon number of points: "<<results[i].border->size()<<std::endl;
+        polygons.push_back(results[i]);
     }
 //     int i=0;
 //     for (auto polygon:polygons)
@@ -166,69 +353,18 @@ std::list< polygon_with_normals > borderExtraction::extractBorders(const std::ve
 
 
 
-pcl::PointCloud< pcl::PointXYZ >::Ptr borderExtraction::douglas_peucker_3d(pcl::PointCloud< pcl::PointXYZRGBNormal >& input,double tolerance)
+pcl::PointCloud< pcl::PointXYZ >::Ptr borderExtraction::simplifyBorder(pcl::PointCloud< pcl::PointXYZRGBNormal >& input, bool ordered, std::ostream& log)
 {
     pcl::PointCloud<pcl::PointXYZ>::Ptr output(new pcl::PointCloud<pcl::PointXYZ>());
     if(!input.size()) return output;
 
-    std::sort(input.begin(),input.end(),atan_compare_2d); //sorting input for douglas_peucker_3d procedure
-
-
-    std::vector <double> pcl_vector;
+    if (!ordered)
+        std::sort(input.begin(),input.end(),atan_compare_2d); //sorting input for the simplification procedure
 
-    for(unsigned int i=0; i<input.size(); i++) {
-        pcl_vector.push_back(input.at(i).x);
-        pcl_vector.push_back(input.at(i).y);
-        pcl_vector.push_back(input.at(i).z);
-    };
-
-    double* result = new double[pcl_vector.size()];
-
-    for(unsigned int h=0; h<pcl_vector.size(); h++) result[h]=0.0;
-
-    double* iter = psimpl::simplify_douglas_peucker <3> (pcl_vector.begin(), pcl_vector.end(), tolerance, result);
-    //double* iter = psimpl::simplify_douglas_peucker_n<3>(pcl_vector.begin(), pcl_vector.end(), 50, result); //variant
-
-    pcl::PointXYZ point;
-
-    unsigned int j=0;
-    bool control=false;
-    unsigned int i;
-
-    for(i=0; i<pcl_vector.size(); i++)
-    {
-        if(&result[i] == iter) break;
-
-        if(!control && j==0)
-        {
-            point.x = result[i];
-            j++;
-            control=true;
-        }
-
-        if(!control && j==1)
-        {
-            point.y = result[i];
-            j++;
-            control=true;
-        }
-
-        if(!control && j==2)
-        {
-            point.z = result[i];
-            j=0;
-            output->push_back(point);
-        }
-
-        control=false;
-    }
-    delete result;
-    std::cout<<"- INFO: i = "<<i<<std::endl;
-    if(j!=0) {
-        std::cout<<"- !! Error in output dimension (no 3d) !!"<<std::endl;
-    }
+    // psimpl reads the coordinates directly from the points
+    output->reserve(polyline_method_==DOUGLAS_PEUCKER_N?polyline_points_:input.size());
+    simplify_polyline(input,polyline_method_,polyline_tolerance_,polyline_points_,*output);
+    log<<"- Simplified border: "<<output->size()<<" of "<<input.size()<<" points"<<std::endl;
 
     return output;
 }
-
-
@@ -0,0 +1,121 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "candidategenerator.h"
+#include <cmath>
+
+using namespace planner;
+
+candidateGenerator::candidateGenerator():max_distance(0),cos_max_yaw(-2),foot_length(0),foot_width(0),position(0),angle(0),World_plane_frame(0),unreachable(0),not_fitting(0)
+{
+}
+
+void candidateGenerator::setSweep(double min_angle, double max_angle, double angle_step)
+{
+    angles.clear();
+    cosines.clear();
+    sines.clear();
+    for (double angle=min_angle;angle<=max_angle;angle=angle+angle_step)
+    {
+        angles.push_back(angle);
+        cosines.push_back(cos(angle));
+        sines.push_back(sin(angle));
+    }
+}
+
+void candidateGenerator::setReach(double max_distance, double max_yaw)
+{
+    this->max_distance=max_distance;
+    // a cosine below -1 accepts every yaw
+    cos_max_yaw=(max_yaw>0 && max_yaw<M_PI)?cos(max_yaw):-2;
+}
+
+void candidateGenerator::setFoot(double length, double width)
+{
+    foot_length=length;
+    foot_width=width;
+}
+
+void candidateGenerator::reset(const std::list< polygon_with_normals >& affordances, const KDL::Frame& World_Camera, const KDL::Frame& World_StanceFoot)
+{
+    polygon=affordances.begin();
+    polygons_end=affordances.end();
+    position=0;
+    angle=angles.size();
+    Camera_World=World_Camera.M.Inverse();
+    StanceFoot_World=World_StanceFoot.Inverse();
+    unreachable=0;
+    not_fitting=0;
+}
+
+void candidateGenerator::nextNormal()
+{
+    angle=0;
+    while (polygon!=polygons_end && position>=polygon->selection.size())
+    {
+        ++polygon;
+        position=0;
+    }
+    if (polygon==polygons_end)
+        return;
+    
+    unsigned int i=polygon->selection[position++];
+    World_plane_frame=&polygon->world->frames[i];
+    if (max_distance>0 && (StanceFoot_World*World_plane_frame->p).Norm()>max_distance)
+    {
+        unreachable+=angles.size();
+        angle=angles.size();
+        return;
+    }
+    StanceFoot_plane_x=StanceFoot_World.M*World_plane_frame->M.UnitX();
+    StanceFoot_plane_y=StanceFoot_World.M*World_plane_frame->M.UnitY();
+    Camera_plane_rotation=Camera_World*World_plane_frame->M;
+    Camera_point=Eigen::Vector3f(polygon->normals->x[i],polygon->normals->y[i],polygon->normals->z[i]);
+}
+
+bool candidateGenerator::next(KDL::Frame& World_MovingFoot)
+{
+    bool check_fit=foot_length>0 && foot_width>0;
+    while (polygon!=polygons_end)
+    {
+        if (angle>=angles.size())
+        {
+            nextNormal();
+            continue;
+        }
+        unsigned int a=angle++;
+        
+        // heading of the sole on the ground of the stance foot
+        double heading_x=cosines[a]*StanceFoot_plane_x.x()+sines[a]*StanceFoot_plane_y.x();
+        double heading_y=cosines[a]*StanceFoot_plane_x.y()+sines[a]*StanceFoot_plane_y.y();
+        if (heading_x<cos_max_yaw*sqrt(heading_x*heading_x+heading_y*heading_y))
+        {
+            unreachable++;
+            continue;
+        }
+        if (check_fit && polygon->raster)
+        {
+            KDL::Vector heading=Camera_plane_rotation*KDL::Vector(cosines[a],sines[a],0);
+            if (!polygon->raster->fits(Camera_point,Eigen::Vector3f(heading.x(),heading.y(),heading.z()),foot_length,foot_width))
+            {
+                not_fitting++;
+                continue;
+            }
+        }
+        World_MovingFoot.p=World_plane_frame->p;
+        World_MovingFoot.M=World_plane_frame->M*KDL::Rotation::RotZ(angles[a]);
+        return true;
+    }
+    return false;
+}
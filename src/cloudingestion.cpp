@@ -0,0 +1,139 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "cloudingestion.h"
+#include <pcl_conversions/pcl_conversions.h>
+
+using namespace planner;
+
+cloudIngestion::cloudIngestion(curvatureFilter* curvature_filter):curvature_filter(curvature_filter),running(false),stopped(true),
+buffer_head(0),buffer_count(0),drop_frames(true),dropped(0),processed_roi_version(0)
+{
+}
+
+cloudIngestion::~cloudIngestion()
+{
+    stop();
+}
+
+void cloudIngestion::start(ros::NodeHandle& nh, std::string topic, int buffer_size, bool drop_frames)
+{
+    if (running)
+        return;
+    buffer.assign(buffer_size>0?buffer_size:1,sensor_msgs::PointCloud2::ConstPtr());
+    buffer_head=0;
+    buffer_count=0;
+    dropped=0;
+    this->drop_frames=drop_frames;
+    stopped=false;
+    running=true;
+    thr=std::thread(&cloudIngestion::worker,this);
+    
+    // the subscription has its own queue and spinner, so it does not wait for the main loop
+    ros::NodeHandle ingestion_nh(nh);
+    ingestion_nh.setCallbackQueue(&queue);
+    subscriber=ingestion_nh.subscribe(topic,1,&cloudIngestion::callback,this);
+    spinner.reset(new ros::AsyncSpinner(1,&queue));
+    spinner->start();
+}
+
+void cloudIngestion::stop()
+{
+    if (!running)
+        return;
+    spinner->stop();
+    subscriber.shutdown();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped=true;
+    }
+    frame_received.notify_all();
+    thr.join();
+    running=false;
+}
+
+bool cloudIngestion::isRunning()
+{
+    return running;
+}
+
+void cloudIngestion::callback(const sensor_msgs::PointCloud2::ConstPtr& msg)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (buffer_count==buffer.size())
+        {
+            // the planner is busy, the oldest frame is lost
+            buffer_head=(buffer_head+1)%buffer.size();
+            buffer_count--;
+            dropped++;
+        }
+        buffer[(buffer_head+buffer_count)%buffer.size()]=msg;
+        buffer_count++;
+    }
+    frame_received.notify_one();
+}
+
+void cloudIngestion::worker()
+{
+    while (true)
+    {
+        sensor_msgs::PointCloud2::ConstPtr msg;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_received.wait(lock,[this]{return stopped || buffer_count>0;});
+            if (stopped)
+                return;
+            if (drop_frames)
+            {
+                // only the newest frame is worth processing
+                dropped+=buffer_count-1;
+                buffer_head=(buffer_head+buffer_count-1)%buffer.size();
+                buffer_count=1;
+            }
+            msg=buffer[buffer_head];
+            buffer[buffer_head].reset();
+            buffer_head=(buffer_head+1)%buffer.size();
+            buffer_count--;
+        }
+        
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
+        pcl::fromROSMsg(*msg, *input_cloud_ptr);
+        unsigned int roi_version;
+        spatialIndex::Ptr index=curvature_filter->preprocess(input_cloud_ptr,&roi_version);
+        
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            processed_index=index;
+            processed_stamp=msg->header.stamp;
+            processed_roi_version=roi_version;
+        }
+        frame_processed.notify_all();
+    }
+}
+
+bool cloudIngestion::getFrame(spatialIndex::Ptr& index, ros::Duration timeout)
+{
+    if (!running)
+        return false;
+    unsigned int roi_version=curvature_filter->getRegionOfInterestVersion();
+    std::unique_lock<std::mutex> lock(mutex);
+    auto ready=[this,roi_version]{return processed_index && processed_stamp>consumed_stamp && processed_roi_version==roi_version;};
+    if (!frame_processed.wait_for(lock,std::chrono::duration<double>(timeout.toSec()),ready))
+        return false;
+    index=processed_index;
+    consumed_stamp=processed_stamp;
+    ROS_INFO_STREAM("using a preprocessed frame " << (ros::Time::now()-processed_stamp).toSec() << " seconds old (" << dropped << " frames dropped so far)");
+    return true;
+}
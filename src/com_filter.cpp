@@ -17,6 +17,7 @@
 #include <iCub/iDynTree/iDyn2KDL.h>
 #include <eigen3/Eigen/Dense>
 #include <thread>
+#include <algorithm>
 #include <tf_conversions/tf_kdl.h>
 #include <tf/transform_broadcaster.h>
 
@@ -25,100 +26,48 @@ double MAX_TESTED_POINTS_2;
 double LEVEL_OF_DETAILS;
 int MAX_THREADS;
 
-bool com_filter::thread_com_filter(std::list<planner::foot_with_joints> &data, int num_threads)
+bool com_filter::thread_com_filter(planner::candidate_store &data, int num_threads)
 {
     if (num_threads>MAX_THREADS)
         num_threads=MAX_THREADS;
-    std::vector<std::list<planner::foot_with_joints>> temp_list;
-    temp_list.resize(num_threads);
-    std::vector<std::list<planner::foot_with_joints>> result_list;
-    result_list.resize(num_threads);
-    std::list<planner::foot_with_joints> result;
-    int data_initial_size=data.size();
-    int partition=data.size()/num_threads;
-    int total=0;
-    for (int i=0;i<num_threads-1;i++)
+    thread_results.resize(num_threads);
+    // the workers cannot report an error, so the joints of both legs are checked against the candidate storage here
+    if (current_stance_chain_and_solver->at(0).chain.getNrOfJoints()+current_moving_chain_and_solver->at(0).chain.getNrOfJoints()>planner::joint_values::capacity)
     {
-        auto it=data.begin();
-        for (int j=0;j<partition;j++)
-        {
-            total++;
-            ++it;
-        }
-        temp_list[i].splice(temp_list[i].begin(),data,data.begin(),it);
-    }
-    auto it=data.begin();
-    int final_size=data_initial_size-total;
-    for (int j=0;j<final_size;j++)
-    {
-        total++;
-        ++it;
+        std::cout<<"ERROR: THE LEGS HAVE MORE JOINTS THAN A CANDIDATE STEP CAN STORE"<<std::endl;
+        data.clear();
+        return false;
     }
-    temp_list[num_threads-1].splice(temp_list[num_threads-1].begin(),data,data.begin(),it);
     
-    assert(total==data_initial_size);
-    std::vector<std::thread> pool;
-    for (int i=0;i<num_threads;i++)
-    {
-        pool.emplace_back(std::thread(&com_filter::internal_filter_first,this,std::ref(temp_list[i]),StanceFoot_World,World_StanceFoot,
-                                      std::ref(result_list[i]),
-                                      &current_stance_chain_and_solver->at(i),
-                                      &current_moving_chain_and_solver->at(i),desired_hip_height));
-    }
-    for (int i=0;i<num_threads;i++)
-    {
-        pool[i].join();
-        result.splice(result.end(),temp_list[i]);
-    }
-    data.swap(result);
-    for (int i=0;i<num_threads-1;i++)
+    // every thread expands a contiguous range of the candidates in its own store, the last one takes the remainder
+    auto run=[&](bool (com_filter::*internal_filter)(const planner::candidate_store&,unsigned int,unsigned int,KDL::Frame,KDL::Frame,
+                                                     planner::candidate_store&,chain_and_solvers*,chain_and_solvers*,double))
     {
-        temp_list[i].clear();
-    }
-    pool.clear();
-    data_initial_size=data.size();
-    partition=data.size()/num_threads;
-    total=0;
-    for (int i=0;i<num_threads-1;i++)
-    {
-        auto it=data.begin();
-        for (int j=0;j<partition;j++)
+        unsigned int partition=data.size()/num_threads;
+        std::vector<std::thread> pool;
+        for (int i=0;i<num_threads;i++)
         {
-            total++;
-            ++it;
+            unsigned int begin=i*partition;
+            unsigned int end=(i==num_threads-1)?data.size():begin+partition;
+            thread_results[i].clear();
+            pool.emplace_back(std::thread(internal_filter,this,std::cref(data),begin,end,StanceFoot_World,World_StanceFoot,
+                                          std::ref(thread_results[i]),
+                                          &current_stance_chain_and_solver->at(i),
+                                          &current_moving_chain_and_solver->at(i),desired_hip_height));
         }
-        temp_list[i].splice(temp_list[i].begin(),data,data.begin(),it);
-    }
-    it=data.begin();
-    final_size=data_initial_size-total;
-    for (int j=0;j<final_size;j++)
-    {
-        total++;
-        ++it;
-    }
-    temp_list[num_threads-1].splice(temp_list[num_threads-1].begin(),data,data.begin(),it);
+        for (int i=0;i<num_threads;i++)
+            pool[i].join();
+        data.clear();
+        for (int i=0;i<num_threads;i++)
+            data.append(thread_results[i]);
+    };
+    run(&com_filter::internal_filter_first);
+    run(&com_filter::internal_filter_second);
     
-    assert(total==data_initial_size);
-    for (int i=0;i<num_threads;i++)
-    {
-        pool.emplace_back(std::thread(&com_filter::internal_filter_second,this,std::ref(temp_list[i]),StanceFoot_World,World_StanceFoot,
-                                      std::ref(result_list[i]),
-                                      &current_stance_chain_and_solver->at(i),
-                                      &current_moving_chain_and_solver->at(i),desired_hip_height));
-    }
-    for (int i=0;i<num_threads;i++)
-    {
-        pool[i].join();
-        result.splice(result.end(),temp_list[i]);
-    }
     current_chain_names=current_stance_chain_and_solver->at(0).joint_names;
     current_chain_names.insert(current_chain_names.end(),current_moving_chain_and_solver->at(0).joint_names.begin(),
                                current_moving_chain_and_solver->at(0).joint_names.end());
-
-    //HACK: temp_list
-    data.swap(result);
     return true;
-    
 }
 
 
@@ -137,60 +86,41 @@ com_filter::com_filter(std::string robot_name_):kinematics(robot_name_)
 }
 
 
-bool com_filter::filter(std::list<planner::foot_with_joints> &data)
+bool com_filter::filter(planner::candidate_store &data)
 {
-   /*
-    //HACK: temp_list
-    std::list<planner::foot_with_joints> temp_list;
-    if (!internal_filter(data,StanceFoot_World,World_StanceFoot,temp_list,current_stance_chain_and_solver,current_moving_chain_and_solver,desired_hip_height))
-        return false;
-    //this->setLeftRightFoot(!left);
-    current_chain_names=current_stance_chain_and_solver->joint_names;
-    current_chain_names.insert(current_chain_names.end(),current_moving_chain_and_solver->joint_names.begin(),current_moving_chain_and_solver->joint_names.end());
-    //HACK: temp_list
-    data.swap(temp_list);
-    return true;
-    */
    return thread_com_filter(data,MAX_THREADS);
 }
 
 
-bool com_filter::internal_filter_first(std::list<planner::foot_with_joints> &data, KDL::Frame StanceFoot_World, KDL::Frame World_StanceFoot,
-                        std::list<planner::foot_with_joints>& temp_list, chain_and_solvers* current_stance_chain_and_solver, 
+bool com_filter::internal_filter_first(const planner::candidate_store &data, unsigned int begin, unsigned int end, KDL::Frame StanceFoot_World, KDL::Frame World_StanceFoot,
+                        planner::candidate_store& result, chain_and_solvers* current_stance_chain_and_solver, 
                         chain_and_solvers* current_moving_chain_and_solver, double desired_hip_height )
 {
-    int total=data.size();
+    int total=end-begin;
     int counter=0;
     int total_num_examined=0;
     int total_num_inserted=0;
     int total_num_failed=0;
-    int mod = (total/MAX_TESTED_POINTS_1);
-    for (auto single_step=data.begin();single_step!=data.end();)
+    // at least one candidate every mod is tested
+    int mod = std::max(1,(int)(total/MAX_TESTED_POINTS_1));
+    KDL::JntArray jnt_temp(current_moving_chain_and_solver->chain.getNrOfJoints()+current_stance_chain_and_solver->chain.getNrOfJoints());
+    for (unsigned int s=begin;s<end;s++)
     {
         counter++;
-	if (counter%mod !=0) 
-	{
-          single_step=data.erase(single_step);
-	  continue;
-	}        auto StanceFoot_MovingFoot=StanceFoot_World*single_step->World_MovingFoot;
-        single_step->World_StanceFoot=World_StanceFoot;
+        if (counter%mod !=0) 
+            continue;
+        const planner::candidate& single_step=data[s];
+        auto StanceFoot_MovingFoot=StanceFoot_World*single_step.World_MovingFoot;
         auto WaistPositions_StanceFoot=generateWaistPositions_StanceFoot(StanceFoot_MovingFoot,StanceFoot_World,LEVEL_OF_DETAILS,desired_hip_height);
-	int num_inserted=0;
         for (auto WaistPosition_StanceFoot:WaistPositions_StanceFoot)
-	{
+        {
             total_num_examined++;
-	    KDL::JntArray jnt_temp(current_moving_chain_and_solver->chain.getNrOfJoints()+current_stance_chain_and_solver->chain.getNrOfJoints());
-	    if (frame_is_stable(StanceFoot_MovingFoot,WaistPosition_StanceFoot,jnt_temp,current_stance_chain_and_solver,current_moving_chain_and_solver))
-	    {
-		planner::foot_with_joints temp;
-		temp.joints=jnt_temp;
-		temp.World_MovingFoot=single_step->World_MovingFoot;
-		temp.World_StanceFoot=single_step->World_StanceFoot;
-		temp.World_Waist=single_step->World_StanceFoot*WaistPosition_StanceFoot.Inverse();
-		data.insert(single_step,temp);
-                //HACK temp_list
-		temp_list.push_back(temp);
-                num_inserted++;
+            if (frame_is_stable(StanceFoot_MovingFoot,WaistPosition_StanceFoot,jnt_temp,current_stance_chain_and_solver,current_moving_chain_and_solver))
+            {
+                planner::candidate& temp=result.add(single_step);
+                temp.joints.assign(jnt_temp);
+                temp.World_StanceFoot=World_StanceFoot;
+                temp.World_Waist=World_StanceFoot*WaistPosition_StanceFoot.Inverse();
                 total_num_inserted++;
                 {
                     tf::Transform current_robot_transform;
@@ -206,25 +136,23 @@ bool com_filter::internal_filter_first(std::list<planner::foot_with_joints> &dat
                     //ros::Duration sleep_time(0.02);
                     //sleep_time.sleep();
                 }
-	    }
-	    else
+            }
+            else
                 total_num_failed++;
-	}
-	single_step=data.erase(single_step);
+        }
         std::cout<<counter<<" / "<<total<<" exam:"<<total_num_examined<<" ins: "<<total_num_inserted<<" fail: "<<total_num_failed<<std::endl;//<<"\r";std::cout.flush();//std::endl;
     }
     std::cout<<std::endl;
+    return true;
 }
     
     
-bool com_filter::internal_filter_second(std::list<planner::foot_with_joints> &data, KDL::Frame StanceFoot_World, KDL::Frame World_StanceFoot,
-                                           std::list<planner::foot_with_joints>& temp_list, chain_and_solvers* current_stance_chain_and_solver, 
+bool com_filter::internal_filter_second(const planner::candidate_store &data, unsigned int begin, unsigned int end, KDL::Frame StanceFoot_World, KDL::Frame World_StanceFoot,
+                                           planner::candidate_store& result, chain_and_solvers* current_stance_chain_and_solver, 
                                            chain_and_solvers* current_moving_chain_and_solver, double desired_hip_height )
     {
-    //HACK temp_list
-    temp_list.clear();
-    std::cout<<"Checking for the second foot configurations: "<<data.size()<<std::endl;
-    int total=data.size();
+    std::cout<<"Checking for the second foot configurations: "<<end-begin<<std::endl;
+    int total=end-begin;
     int counter=0;
     int total_num_examined=0;
     int total_num_inserted=0;
@@ -233,64 +161,44 @@ bool com_filter::internal_filter_second(std::list<planner::foot_with_joints> &da
     auto temp=current_stance_chain_and_solver;
     current_stance_chain_and_solver=current_moving_chain_and_solver;
     current_moving_chain_and_solver=temp;
-    //this->setLeftRightFoot(!left);
 
-
-
-    //total=total_num_inserted;
-    counter=0;
-    total_num_examined=0;
-    total_num_inserted=0;
-    total_num_failed=0;
-    int mod = (total/MAX_TESTED_POINTS_2);
-    for (auto single_step=data.begin();single_step!=data.end();)
+    // at least one candidate every mod is tested
+    int mod = std::max(1,(int)(total/MAX_TESTED_POINTS_2));
+    KDL::JntArray jnt_temp(current_moving_chain_and_solver->chain.getNrOfJoints()+current_stance_chain_and_solver->chain.getNrOfJoints());
+    for (unsigned int s=begin;s<end;s++)
     {
         counter++;
-	if (counter%mod !=0) 
-	{
-          single_step=data.erase(single_step);
-	  continue;
-	}
-        auto MovingFoot_StanceFoot=(StanceFoot_World*single_step->World_MovingFoot).Inverse();
-        single_step->World_StanceFoot=World_StanceFoot;
-        auto WaistPositions_MovingFoot=generateWaistPositions_StanceFoot(MovingFoot_StanceFoot,single_step->World_MovingFoot.Inverse(),LEVEL_OF_DETAILS,desired_hip_height);
-        int num_inserted=0;
+        if (counter%mod !=0) 
+            continue;
+        const planner::candidate& single_step=data[s];
+        auto MovingFoot_StanceFoot=(StanceFoot_World*single_step.World_MovingFoot).Inverse();
+        auto WaistPositions_MovingFoot=generateWaistPositions_StanceFoot(MovingFoot_StanceFoot,single_step.World_MovingFoot.Inverse(),LEVEL_OF_DETAILS,desired_hip_height);
         for (auto WaistPosition_MovingFoot:WaistPositions_MovingFoot)
         {
             total_num_examined++;
-            KDL::JntArray jnt_temp(current_moving_chain_and_solver->chain.getNrOfJoints()+current_stance_chain_and_solver->chain.getNrOfJoints());
             if (frame_is_stable(MovingFoot_StanceFoot,WaistPosition_MovingFoot,jnt_temp,current_stance_chain_and_solver,current_moving_chain_and_solver))
             {
-                planner::foot_with_joints temp;
-                temp.start_joints=single_step->joints;
+                planner::candidate& temp=result.add(single_step);
+                temp.World_StanceFoot=World_StanceFoot;
+                temp.start_joints=single_step.joints;
                 //We are going to swap stance and moving foot joints in order to give back to the planner the same order for start and end joints
-                KDL::JntArray swap_jnt=jnt_temp;
-                auto leg_size=swap_jnt.rows()/2;
+                auto leg_size=jnt_temp.rows()/2;
+                temp.end_joints.resize(jnt_temp.rows());
                 for (int i=0;i<leg_size;i++)
                 {
-                    jnt_temp(i)=swap_jnt(i+leg_size);
-                    jnt_temp(i+leg_size)=swap_jnt(i);
+                    temp.end_joints.q[i]=jnt_temp(i+leg_size);
+                    temp.end_joints.q[i+leg_size]=jnt_temp(i);
                 }
-                temp.end_joints=jnt_temp;
-                temp.joints=single_step->joints;
-                temp.World_Waist=single_step->World_Waist;
-                temp.World_MovingFoot=single_step->World_MovingFoot;
-                temp.World_StanceFoot=single_step->World_StanceFoot;
-                temp.World_StartWaist=single_step->World_StartWaist;
-                temp.World_EndWaist=single_step->World_MovingFoot*WaistPosition_MovingFoot.Inverse();
-                data.insert(single_step,temp);
-                //HACK temp_list
-                temp_list.push_back(temp);
-                num_inserted++;
+                temp.World_EndWaist=single_step.World_MovingFoot*WaistPosition_MovingFoot.Inverse();
                 total_num_inserted++;
             }
             else
                 total_num_failed++;
         }
-        single_step=data.erase(single_step);
         std::cout<<counter<<" / "<<total<<" exam:"<<total_num_examined<<" ins: "<<total_num_inserted<<" fail: "<<total_num_failed<<std::endl;//<<"\r";std::cout.flush();//std::endl;
     }
     std::cout<<std::endl;
+    return true;
 }
 
 
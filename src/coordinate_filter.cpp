@@ -49,6 +49,40 @@ void coordinate_filter::set_stance_foot(KDL::Frame StanceFoot_Camera)
     stance_foot_set = true;
 }
 
+void coordinate_filter::update_bounds(bool left)
+{
+    axis_max =multiplier_axis*axis_max+multiplier_default* ((left)*default_axis_max + (!left)*(-default_axis_min));
+    axis_min =multiplier_axis*axis_min+multiplier_default* ((left)*default_axis_min + (!left)*(-default_axis_max));
+}
+
+coordinate_predicate coordinate_filter::get_predicate(bool left)
+{
+    coordinate_predicate predicate;
+    predicate.enabled=stance_foot_set;
+    if(!stance_foot_set)
+    {
+        std::cout<<"ERROR: STANCE FOOT NOT SET"<<std::endl;
+        return predicate;
+    }
+    
+    update_bounds(left);
+    predicate.plane[0]=m_x; predicate.plane[1]=m_y; predicate.plane[2]=m_z; predicate.plane[3]=t;
+    predicate.axis_min=axis_min; predicate.axis_max=axis_max;
+    return predicate;
+}
+
+coordinate_predicate coordinate_filter::get_predicate(bool left, const KDL::Frame& StanceFoot_Points)
+{
+    coordinate_predicate predicate;
+    predicate.enabled=true;
+    update_bounds(left);
+    for (int j=0; j<3; j++)
+        predicate.plane[j]=StanceFoot_Points.M(filter_axis,j);
+    predicate.plane[3]=StanceFoot_Points.p[filter_axis];
+    predicate.axis_min=axis_min; predicate.axis_max=axis_max;
+    return predicate;
+}
+
 bool coordinate_filter::border_is_in_bounds(pcl::PointCloud<pcl::PointXYZ>::Ptr border)
 {
     double value;
@@ -63,9 +97,9 @@ bool coordinate_filter::border_is_in_bounds(pcl::PointCloud<pcl::PointXYZ>::Ptr
     return false;
 }
 
-bool coordinate_filter::point_is_in_bounds(pcl::PointXYZRGBNormal& point)
+bool coordinate_filter::point_is_in_bounds(float x, float y, float z)
 {
-    value = m_x*point.x + m_y*point.y + m_z*point.z+t;
+    value = m_x*x + m_y*y + m_z*z+t;
     if(value > axis_max || value < axis_min) return false;
 		
     return true;
@@ -79,8 +113,7 @@ void coordinate_filter::filter_borders(std::list<polygon_with_normals>& data, bo
         return;
     }
     
-    axis_max =multiplier_axis*axis_max+multiplier_default* ((left)*default_axis_max + (!left)*(-default_axis_min));
-    axis_min =multiplier_axis*axis_min+multiplier_default* ((left)*default_axis_min + (!left)*(-default_axis_max));
+    update_bounds(left);
     
     for(std::list<polygon_with_normals>::iterator it=data.begin(); it!=data.end();)
     {
@@ -101,22 +134,24 @@ void coordinate_filter::filter_points(std::list<polygon_with_normals>& data, boo
         return;
     }
    
-    axis_max =multiplier_axis*axis_max+multiplier_default* ((left)*default_axis_max + (!left)*(-default_axis_min));
-    axis_min =multiplier_axis*axis_min+multiplier_default* ((left)*default_axis_min + (!left)*(-default_axis_max));
+    update_bounds(left);
 
-    for(auto item:data)
+    for(auto& item:data)
     {	  
-        pcl::PointCloud<pcl::PointXYZRGBNormal> points;
+        const normal_points& points=*item.normals;
+        std::vector<unsigned int>& selection=item.selection;
+        unsigned int kept=0;
 
-        for(pcl::PointCloud<pcl::PointXYZRGBNormal>::iterator it=item.normals->begin(); it!=item.normals->end();++it)
+        for(unsigned int i=0; i<selection.size(); i++)
 	{
-            if(point_is_in_bounds(*it))
+            unsigned int j=selection[i];
+            if(point_is_in_bounds(points.x[j],points.y[j],points.z[j]))
 	    {
-                points.push_back(*it); //TODO: controllare se va bene eliminare le normali dai piani
+                selection[kept++]=j; //TODO: controllare se va bene eliminare le normali dai piani
 	    }
 	}
 	
-        *(item.normals) = points;
+        selection.resize(kept);
 
     }
 }
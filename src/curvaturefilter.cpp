@@ -13,18 +13,40 @@
  * limitations under the License.*/
 
 #include "curvaturefilter.h"
+#include "voxelclustering.h"
 #include <ros_publisher.h>
 #include <ros/ros.h>
 #include <pcl_conversions/pcl_conversions.h>
-#include <pcl/filters/filter.h>
-#include <pcl/filters/voxel_grid.h>
 #include <pcl/features/normal_3d.h>
-#include <pcl/segmentation/conditional_euclidean_clustering.h>
+#include <pcl/features/normal_3d_omp.h>
+#include <pcl/features/integral_image_normal.h>
 #include <eigen3/Eigen/src/Core/Map.h>
+#include <param_manager.h>
+#include <algorithm>
 
 
 using namespace planner;
 
+curvatureFilter::curvatureFilter():roi_center(0,0,0),roi_radius(0),roi_version(0),plane_map(NULL)
+{
+    param_manager::register_param("normal_threads",normal_threads_);
+    param_manager::update_param("normal_threads",0);
+    param_manager::register_param("downsample_threads",downsample_threads_);
+    param_manager::update_param("downsample_threads",0);
+    param_manager::register_param("normal_engine",normal_engine_);
+    param_manager::update_param("normal_engine",RADIUS_SEARCH_NORMALS);
+    param_manager::register_param("organized_normals",organized_normals_);
+    param_manager::update_param("organized_normals",1);
+    param_manager::register_param("integral_max_depth_change",integral_max_depth_change_);
+    param_manager::update_param("integral_max_depth_change",0.02);
+    param_manager::register_param("integral_smoothing_size",integral_smoothing_size_);
+    param_manager::update_param("integral_smoothing_size",10.0);
+    param_manager::register_param("clustering_engine",clustering_engine_);
+    param_manager::update_param("clustering_engine",CONDITIONAL_EUCLIDEAN_CLUSTERING);
+    param_manager::register_param("max_range",max_range_);
+    param_manager::update_param("max_range",0.0);
+}
+
 
 void curvatureFilter::setParams(double curvature_threshold_,double voxel_size_, double normal_radius_, int min_cluster_size_, double cluster_tolerance_)
 {
@@ -35,88 +57,259 @@ void curvatureFilter::setParams(double curvature_threshold_,double voxel_size_,
     this->min_cluster_size_=min_cluster_size_;
 }
 
+void curvatureFilter::computeNormals(spatialIndex& index)
+{
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud_ptr = index.getCloud();
+    pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr tree = index.getTree();
+    
+    // normals are written in place: the estimator only reads the coordinates of the input points
+    if (normal_threads_==1)
+    {
+        pcl::NormalEstimation<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal> ne;
+        ne.setInputCloud (cloud_ptr);
+        ne.setSearchMethod (tree);
+        ne.setViewPoint(0,0,0);
+        ne.setRadiusSearch (normal_radius_);
+        ne.compute (*cloud_ptr);
+        return;
+    }
+    
+    // every point is processed independently with the same code of the serial estimator, so the result is the same
+    pcl::NormalEstimationOMP<pcl::PointXYZRGBNormal, pcl::PointXYZRGBNormal> ne(normal_threads_>0?normal_threads_:0);
+    ne.setInputCloud (cloud_ptr);
+    ne.setSearchMethod (tree);
+    ne.setViewPoint(0,0,0);
+    ne.setRadiusSearch (normal_radius_);
+    ne.compute (*cloud_ptr);
+}
+
+// TODO: avoid this magic number here!
+// minimum absolute dot product between the normals of two neighbours in the same cluster
+static const double NORMAL_SIMILARITY_THRESHOLD=0.9995;
+
 // custom condition for euclidean clustering
 // for instance check the difference of the normals in clusters
 bool enforceCurvature (const pcl::PointXYZRGBNormal& point_a, const pcl::PointXYZRGBNormal& point_b, float squared_distance)
 {
     Eigen::Map<const Eigen::Vector3f> point_a_normal = point_a.normal, point_b_normal = point_b.normal;
     
-    // TODO: avoid this magic number here!
-    if (fabs (point_a_normal.dot (point_b_normal)) > 0.9995)
+    if (fabs (point_a_normal.dot (point_b_normal)) > NORMAL_SIMILARITY_THRESHOLD)
     {
         return (true);
     }
     return (false);
 }
 
-std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  curvatureFilter::filterByCurvature(ros_publisher* publish,pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr)
+void curvatureFilter::conditionalClustering(spatialIndex& index, std::vector<pcl::PointIndices>& cluster_indices, const std::vector<bool>* mask)
+{
+    // same region growing of pcl::ConditionalEuclideanClustering, but on the tree shared by the whole capture
+    pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud = *index.getCloud();
+    pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr tree = index.getTree();
+    std::vector<bool> processed(cloud.size(),false);
+    if (mask)
+    {
+        // masked points are neither seeds nor neighbours
+        for (unsigned int i=0; i<cloud.size(); i++)
+            processed[i]=!(*mask)[i];
+    }
+    std::vector<int> nn_indices;
+    std::vector<float> nn_distances;
+    
+    for (unsigned int seed=0; seed<cloud.size(); seed++)
+    {
+        if (processed[seed])
+            continue;
+        
+        std::vector<int> current_cluster;
+        current_cluster.push_back(seed);
+        processed[seed]=true;
+        
+        for (unsigned int cii=0; cii<current_cluster.size(); cii++)
+        {
+            if (tree->radiusSearch(current_cluster[cii],cluster_tolerance_,nn_indices,nn_distances)<1)
+                continue;
+            for (unsigned int nii=0; nii<nn_indices.size(); nii++)
+            {
+                if (processed[nn_indices[nii]])
+                    continue;
+                if (enforceCurvature(cloud.points[current_cluster[cii]],cloud.points[nn_indices[nii]],nn_distances[nii]))
+                {
+                    current_cluster.push_back(nn_indices[nii]);
+                    processed[nn_indices[nii]]=true;
+                }
+            }
+        }
+        
+        if ((int)current_cluster.size()>=min_cluster_size_)
+        {
+            cluster_indices.push_back(pcl::PointIndices());
+            cluster_indices.back().indices.swap(current_cluster);
+        }
+    }
+}
+
+spatialIndex::Ptr curvatureFilter::computeCloudWithNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr)
 {
     ros::Time start_time = ros::Time::now();
     
-    std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  clusters;
-    //remove nans
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
-    std::vector<int> nans;
-    pcl::removeNaNFromPointCloud(*input_cloud_ptr, *cloud_ptr, nans);
-    
-    pcl::VoxelGrid<pcl::PointXYZRGB> grid;
-    grid.setLeafSize (voxel_size_, voxel_size_, voxel_size_);
-    grid.setFilterFieldName ("z");
-    grid.setDownsampleAllData (false);
-    grid.setInputCloud (cloud_ptr);
-    
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr cloud_downsampled_ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
-    grid.filter (*cloud_downsampled_ptr);
-    
-    pcl::PointCloud<pcl::PointXYZRGB> cloud;
-    cloud = *cloud_downsampled_ptr;
-    
-    // compute normals and curvature
-    //pcl::NormalEstimationOMP<pcl::PointXYZRGB, pcl::Normal> ne;
-    pcl::NormalEstimation<pcl::PointXYZRGB, pcl::Normal> ne;
-    pcl::search::KdTree<pcl::PointXYZRGB>::Ptr tree (new pcl::search::KdTree<pcl::PointXYZRGB> ());
-    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals_ptr (new pcl::PointCloud<pcl::Normal> ());
+    // remove nans, points out of range and downsample in a single pass
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud_with_normals_ptr (new pcl::PointCloud<pcl::PointXYZRGBNormal> ());
+    downsampler.setLeafSize(voxel_size_);
+    downsampler.setMaxRange(max_range_);
+    downsampler.setThreads(downsample_threads_);
+    // cells of 2/3 of the radius, so that the 3x3x3 cells around a point cover about the same neighbourhood of the radius search
+    downsampler.setMomentsCellSize(normal_engine_==VOXEL_COVARIANCE_NORMALS?normal_radius_*2.0/3.0:0);
+    downsampler.filter(*input_cloud_ptr,*cloud_with_normals_ptr);
     
-    ne.setInputCloud (cloud_downsampled_ptr);
-    ne.setSearchMethod (tree);
+    ROS_INFO_STREAM("Downsampling time: " << ros::Time::now() - start_time << " seconds");
+    ros::Time normals_time = ros::Time::now();
+    
+    // compute normals and curvature, the tree built here is used by the rest of the pipeline
+    spatialIndex::Ptr index(new spatialIndex(cloud_with_normals_ptr));
+    if (normal_engine_==VOXEL_COVARIANCE_NORMALS)
+        downsampler.computeNormals(*cloud_with_normals_ptr);
+    else
+        computeNormals(*index);
+    
+    ROS_INFO_STREAM("Normal estimation time: " << ros::Time::now() - normals_time << " seconds (" << cloud_with_normals_ptr->size() << " normals)");
+    
+    //publish->publish_normal_cloud(cloud_with_normals_ptr,0);
+    return index;
+}
+
+spatialIndex::Ptr curvatureFilter::computeOrganizedCloudWithNormals(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr)
+{
+    ros::Time start_time = ros::Time::now();
+    
+    // normals are computed on the image grid, nans are kept so that the cloud stays organized
+    pcl::IntegralImageNormalEstimation<pcl::PointXYZRGB, pcl::Normal> ne;
+    pcl::PointCloud<pcl::Normal>::Ptr cloud_normals_ptr (new pcl::PointCloud<pcl::Normal> ());
+    ne.setNormalEstimationMethod (pcl::IntegralImageNormalEstimation<pcl::PointXYZRGB, pcl::Normal>::AVERAGE_3D_GRADIENT);
+    ne.setMaxDepthChangeFactor (integral_max_depth_change_);
+    ne.setNormalSmoothingSize (integral_smoothing_size_);
     ne.setViewPoint(0,0,0);
-    ne.setRadiusSearch (normal_radius_);
+    ne.setInputCloud (input_cloud_ptr);
     ne.compute (*cloud_normals_ptr);
     
-//     int Normals = (int) cloud_normals_ptr->points.size();
-// 
-//     pcl::PointCloud<pcl::Normal>::Ptr show_normals(new pcl::PointCloud<pcl::Normal>());
-//     pcl::PointCloud<pcl::PointXYZRGB>::Ptr show_points(new pcl::PointCloud<pcl::PointXYZRGB>());
-//     
-//     for (int i=0;i<Normals;i++)
-//     {
-//       if (cloud_downsampled_ptr->at(i).x>0.5 && cloud_downsampled_ptr->at(i).z<1.4)//
-//       {
-// 	show_normals->push_back(cloud_normals_ptr->at(i));
-// 	show_points->push_back(cloud_downsampled_ptr->at(i));
-//       }
-//     }
-    //publish->publish_normal_cloud(show_normals,show_points,0);
-    //publish->publish_normal_cloud(cloud_normals_ptr,cloud_downsampled_ptr,0);
+    ROS_INFO_STREAM("Integral image normal estimation time: " << ros::Time::now() - start_time << " seconds");
+    ros::Time downsample_time = ros::Time::now();
+    
+    // only now we downsample, dropping invalid pixels and averaging normals inside each voxel
     pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud_with_normals_ptr (new pcl::PointCloud<pcl::PointXYZRGBNormal> ());
-    pcl::concatenateFields( *cloud_downsampled_ptr, *cloud_normals_ptr, *cloud_with_normals_ptr );
-    pcl::PointCloud<pcl::PointXYZRGBNormal> cloud_with_normals;
-    cloud_with_normals = *cloud_with_normals_ptr;
+    downsampler.setLeafSize(voxel_size_);
+    downsampler.setMaxRange(max_range_);
+    downsampler.setThreads(downsample_threads_);
+    // the integral image gives no curvature, so the curvature pruning takes it from the moments of the downsampler
+    downsampler.setMomentsCellSize(curvature_threshold_>0?normal_radius_*2.0/3.0:0);
+    downsampler.filter(*input_cloud_ptr,*cloud_with_normals_ptr,cloud_normals_ptr.get());
+    if (curvature_threshold_>0)
+        downsampler.computeNormals(*cloud_with_normals_ptr,true);
     
+    ROS_INFO_STREAM("Downsampling time: " << ros::Time::now() - downsample_time << " seconds (" << cloud_with_normals_ptr->size() << " normals)");
+    
+    return spatialIndex::Ptr(new spatialIndex(cloud_with_normals_ptr));
+}
+
+void curvatureFilter::setRegionOfInterest(const Eigen::Vector3f& Camera_center, double radius)
+{
+    std::lock_guard<std::mutex> lock(preprocess_mutex);
+    if (Camera_center==roi_center && radius==roi_radius)
+        return;
+    roi_center=Camera_center;
+    roi_radius=radius;
+    roi_version++;
+    downsampler.setRegionOfInterest(Camera_center,radius);
+}
+
+unsigned int curvatureFilter::getRegionOfInterestVersion()
+{
+    std::lock_guard<std::mutex> lock(preprocess_mutex);
+    return roi_version;
+}
+
+spatialIndex::Ptr curvatureFilter::preprocess(pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr, unsigned int* roi_version)
+{
+    std::lock_guard<std::mutex> lock(preprocess_mutex);
+    if (roi_version)
+        *roi_version=this->roi_version;
+    if (organized_normals_ && input_cloud_ptr->height>1)
+        return computeOrganizedCloudWithNormals(input_cloud_ptr);
+    else
+        return computeCloudWithNormals(input_cloud_ptr);
+}
+
+spatialIndex::Ptr curvatureFilter::getSpatialIndex()
+{
+    return current_index;
+}
+
+void curvatureFilter::setPlaneMap(planeMap* plane_map, const Eigen::Affine3f& World_Camera)
+{
+    this->plane_map=plane_map;
+    this->World_Camera=World_Camera;
+}
+
+std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  curvatureFilter::filterByCurvature(ros_publisher* publish,pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr)
+{
+    return filterByCurvature(publish,preprocess(input_cloud_ptr));
+}
+
+std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  curvatureFilter::filterByCurvature(ros_publisher* publish,spatialIndex::Ptr index)
+{
+    ros::Time start_time = ros::Time::now();
+    
+    std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  clusters;
+    
+    current_index=index;
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud_with_normals_ptr=current_index->getCloud();
+    pcl::PointCloud<pcl::PointXYZRGBNormal>& cloud_with_normals=*cloud_with_normals_ptr;
     
     int N = (int) cloud_with_normals.points.size();
     printf("Cloud size is %i", N);
-    // perform conditional euclidean clustering on the cloud with planar areas only
-    // we need another tree because this cloud is different
-    pcl::search::KdTree<pcl::PointXYZRGBNormal>::Ptr another_tree (new pcl::search::KdTree<pcl::PointXYZRGBNormal>);
+    ros::Time clustering_time = ros::Time::now();
+    std::vector<bool> reprocess;
+    const std::vector<bool>* mask=NULL;
+    if (plane_map)
+    {
+        plane_map->update(cloud_with_normals,World_Camera,reprocess);
+        mask=&reprocess;
+        ROS_INFO_STREAM("Plane map: " << std::count(reprocess.begin(),reprocess.end(),true) << " points of " << N << " changed");
+    }
+    
+    // edges and clutter can not be part of a plane, so they do not go through the clustering
+    if (curvature_threshold_>0)
+    {
+        if (!mask)
+            reprocess.assign(N,true);
+        mask=&reprocess;
+        int pruned=0;
+        for (int i=0;i<N;i++)
+        {
+            if (reprocess[i] && !(cloud_with_normals.points[i].curvature<=curvature_threshold_))
+            {
+                reprocess[i]=false;
+                pruned++;
+            }
+        }
+        ROS_INFO_STREAM("Curvature pruning removed " << pruned << " points of " << N);
+    }
     std::vector<pcl::PointIndices> cluster_indices;
-    pcl::ConditionalEuclideanClustering<pcl::PointXYZRGBNormal> ec;
-    ec.setClusterTolerance (cluster_tolerance_);
-    ec.setMinClusterSize (min_cluster_size_);
-    ec.setMaxClusterSize (10000000); // a point cloud only has around 300000 so we are safe here
-    ec.setInputCloud (cloud_with_normals_ptr);
-    ec.setConditionFunction(enforceCurvature);
-    ec.segment (cluster_indices);
+    if (clustering_engine_==VOXEL_ADJACENCY_CLUSTERING)
+    {
+        // the cloud is already voxelised, so neighbours are found on the grid itself
+        voxelClustering vc;
+        vc.setVoxelSize(voxel_size_);
+        vc.setMinClusterSize(min_cluster_size_);
+        vc.setNormalThreshold(NORMAL_SIMILARITY_THRESHOLD);
+        vc.segment(cloud_with_normals,cluster_indices,mask);
+    }
+    else
+    {
+        // perform conditional euclidean clustering on the cloud with planar areas only
+        conditionalClustering(*current_index,cluster_indices,mask);
+    }
+    current_index->setClusters(cluster_indices);
+    ROS_INFO_STREAM("Clustering time: " << ros::Time::now() - clustering_time << " seconds");
     
     printf( "Found %lu clusters", cluster_indices.size() );
     
@@ -152,6 +345,7 @@ std::vector< pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr >  curvatureFilter::fi
         
         j++;
     }
+    current_index->setClusterClouds(clusters);
     
 //     int i=0;
 //     for (auto polygon:clusters)
@@ -0,0 +1,76 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+// compares pcl::VoxelGrid with voxelDownsampler, usage: downsampler_benchmark [cloud.pcd] [leaf size] [iterations]
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <pcl/io/pcd_io.h>
+#include <pcl/filters/voxel_grid.h>
+#include <pcl/filters/filter.h>
+#include "voxeldownsampler.h"
+
+template<typename Function>
+double average_time(int iterations, Function function)
+{
+    auto start=std::chrono::steady_clock::now();
+    for (int i=0;i<iterations;i++)
+        function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count()/iterations;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filename=argc>1?argv[1]:"resources/another_scene.pcd";
+    double leaf_size=argc>2?atof(argv[2]):0.01;
+    int iterations=argc>3?atoi(argv[3]):20;
+    
+    pcl::PointCloud<pcl::PointXYZRGB>::Ptr input(new pcl::PointCloud<pcl::PointXYZRGB>);
+    if (pcl::io::loadPCDFile(filename,*input)<0)
+    {
+        std::cout<<"could not read "<<filename<<std::endl;
+        return 1;
+    }
+    std::cout<<filename<<": "<<input->size()<<" points, leaf size "<<leaf_size<<", "<<iterations<<" iterations"<<std::endl;
+    
+    // VoxelGrid does not drop nans by itself on organized clouds, the pipeline used to remove them before
+    pcl::PointCloud<pcl::PointXYZRGB> voxel_grid_output;
+    double voxel_grid_time=average_time(iterations,[&]()
+    {
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr dense(new pcl::PointCloud<pcl::PointXYZRGB>);
+        std::vector<int> indices;
+        pcl::removeNaNFromPointCloud(*input,*dense,indices);
+        pcl::VoxelGrid<pcl::PointXYZRGB> voxel_grid;
+        voxel_grid.setInputCloud(dense);
+        voxel_grid.setLeafSize(leaf_size,leaf_size,leaf_size);
+        voxel_grid.filter(voxel_grid_output);
+    });
+    std::cout<<"pcl::VoxelGrid: "<<voxel_grid_time*1000<<" ms, "<<voxel_grid_output.size()<<" points"<<std::endl;
+    
+    // the thread counts are fixed so that runs on different machines compare, the rows beyond the cores show no scaling
+    int cores=std::max<int>(std::thread::hardware_concurrency(),1);
+    std::cout<<cores<<" cores"<<std::endl;
+    for (int threads=1;threads<=8;threads*=2)
+    {
+        planner::voxelDownsampler downsampler;
+        downsampler.setLeafSize(leaf_size);
+        downsampler.setThreads(threads);
+        pcl::PointCloud<pcl::PointXYZRGBNormal> output;
+        double time=average_time(iterations,[&](){downsampler.filter(*input,output);});
+        std::cout<<"voxelDownsampler ("<<threads<<(threads==1?" thread, hash map":" threads, radix sort")<<"): "<<time*1000<<" ms, "<<output.size()<<" points, speedup "<<voxel_grid_time/time
+                 <<(threads>cores?" (more threads than cores)":"")<<std::endl;
+    }
+    return 0;
+}
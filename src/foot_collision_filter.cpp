@@ -29,12 +29,36 @@ void foot_collision_filter::set_stance_foot(KDL::Frame StanceFoot_Camera_)
 }
 
 
-bool foot_collision_filter::point_is_in_bounds(pcl::PointXYZRGBNormal& point)
+foot_collision_predicate foot_collision_filter::get_predicate(bool left)
+{
+    if(!stance_foot_set)
+    {
+        foot_collision_predicate predicate;
+        predicate.enabled=false;
+        std::cout<<"ERROR: STANCE FOOT NOT SET"<<std::endl;
+        return predicate;
+    }
+    
+    return get_predicate(left,StanceFoot_Camera);
+}
+
+foot_collision_predicate foot_collision_filter::get_predicate(bool left, const KDL::Frame& StanceFoot_Points)
+{
+    foot_collision_predicate predicate;
+    predicate.enabled=true;
+    l = ((left)*default_l + (!left)*(-default_l));
+    for (int j=0; j<3; j++)
+        predicate.plane[j]=StanceFoot_Points.M(0,j)-(h/l)*StanceFoot_Points.M(1,j);
+    predicate.plane[3]=StanceFoot_Points.p.x()-(h/l)*StanceFoot_Points.p.y()-h;
+    return predicate;
+}
+
+bool foot_collision_filter::point_is_in_bounds(float x, float y, float z)
 {
     KDL::Vector Camera_point;
-    Camera_point.x(point.x);
-    Camera_point.y(point.y);
-    Camera_point.z(point.z);
+    Camera_point.x(x);
+    Camera_point.y(y);
+    Camera_point.z(z);
     
     StanceFoot_point = StanceFoot_Camera*Camera_point;
     
@@ -55,19 +79,22 @@ void foot_collision_filter::filter_points(std::list<polygon_with_normals>& data,
     
     l = ((left)*default_l + (!left)*(-default_l));
 
-    for(auto item:data)
+    for(auto& item:data)
     {	  
-        pcl::PointCloud<pcl::PointXYZRGBNormal> points;
+        const normal_points& points=*item.normals;
+        std::vector<unsigned int>& selection=item.selection;
+        unsigned int kept=0;
 
-        for(pcl::PointCloud<pcl::PointXYZRGBNormal>::iterator it=item.normals->begin(); it!=item.normals->end();++it)
+        for(unsigned int i=0; i<selection.size(); i++)
 	{
-            if(point_is_in_bounds(*it))
+            unsigned int j=selection[i];
+            if(point_is_in_bounds(points.x[j],points.y[j],points.z[j]))
 	    {
-                points.push_back(*it);
+                selection[kept++]=j;
 	    }
 	}
 	
-        *(item.normals) = points;
+        selection.resize(kept);
 
     }
 }
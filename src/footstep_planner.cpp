@@ -21,6 +21,7 @@ limitations under the License.*/
 #include <tf_conversions/tf_kdl.h>
 #include <stdlib.h>     /* srand, rand */
 #include <cmath>
+#include <algorithm>
 
 using namespace planner;
 
@@ -28,6 +29,22 @@ double DISTANCE_THRESHOLD; //0.02*0.02 //We work with squares of distances, so t
 double ANGLE_THRESHOLD;// 0.2
 double WAIST_THRESHOLD;// 0.2
 
+// upper bound of the distance between the base and the tip of a chain of revolute joints, whatever their values;
+// 0 (no bound) when a joint can translate
+static double chain_reach(const KDL::Chain& chain)
+{
+    double reach=0;
+    for (unsigned int i=0;i<chain.getNrOfSegments();i++)
+    {
+        const KDL::Segment& segment=chain.getSegment(i);
+        KDL::Joint::JointType type=segment.getJoint().getType();
+        if (type!=KDL::Joint::None && type!=KDL::Joint::RotAxis && type!=KDL::Joint::RotX && type!=KDL::Joint::RotY && type!=KDL::Joint::RotZ)
+            return 0;
+        reach+=segment.getFrameToTip().p.Norm();
+    }
+    return reach;
+}
+
 footstepPlanner::footstepPlanner(std::string robot_name_, ros_publisher* ros_pub_):kinematicFilter(robot_name_),comFilter(robot_name_),stepQualityEvaluator(robot_name_),kinematics(kinematicFilter.kinematics), World_CurrentDirection(1,0,0) //TODO:remove kinematics from here
 {
     param_manager::register_param("DISTANCE_THRESHOLD",DISTANCE_THRESHOLD);
@@ -43,6 +60,18 @@ footstepPlanner::footstepPlanner(std::string robot_name_, ros_publisher* ros_pub
     param_manager::update_param("kin_max_angle",0.8);
     param_manager::register_param("kin_angle_step",angle_step);
     param_manager::update_param("kin_angle_step",0.2);
+    param_manager::register_param("foot_length",foot_length);
+    param_manager::update_param("foot_length",0.2);
+    param_manager::register_param("foot_width",foot_width);
+    param_manager::update_param("foot_width",0.1);
+    // the stretched legs bound the distance of every pose the IK can reach, so this never drops a feasible step
+    double left_reach=chain_reach(kinematics.lwr_legs.chain), right_reach=chain_reach(kinematics.rwl_legs.chain);
+    double legs_reach=(left_reach>0 && right_reach>0)?std::max(left_reach,right_reach):0;
+    param_manager::register_param("max_step_distance",max_step_distance);
+    param_manager::update_param("max_step_distance",legs_reach);
+    // there is no safe bound for the yaw, so it is only checked when set
+    param_manager::register_param("max_step_yaw",max_step_yaw);
+    param_manager::update_param("max_step_yaw",0.0);
     
     KDL::Frame Waist_StanceFoot;
     left_joints.resize(kinematics.wl_leg.chain.getNrOfJoints());
@@ -133,10 +162,59 @@ void footstepPlanner::setParams(double feasible_area_)
     this->feasible_area_=feasible_area_;
 }
 
+bool footstepPlanner::getRegionOfInterest(Eigen::Vector3f& Camera_center, double& radius)
+{
+    if (!world_camera_set)
+        return false;
+    KDL::Vector Camera_StanceFoot=World_Camera.Inverse()*World_StanceFoot.p;
+    Camera_center<<Camera_StanceFoot.x(),Camera_StanceFoot.y(),Camera_StanceFoot.z();
+    radius=feasible_area_;
+    return true;
+}
+
 void footstepPlanner::setWorldTransform(KDL::Frame transform)
 {
     this->World_Camera=transform;
     world_camera_set=true;
+    // the boxes of the indexed affordances are not valid any more
+    affordance_index.clear();
+}
+
+void footstepPlanner::indexAffordances(std::list< polygon_with_normals >& affordances)
+{
+    std::vector<Eigen::AlignedBox3f> boxes;
+    boxes.reserve(affordances.size());
+    for (auto& polygon:affordances)
+    {
+        polygon.world_box.setEmpty();
+        for (auto const& point:polygon.border->points)
+        {
+            KDL::Vector World_point=World_Camera*KDL::Vector(point.x,point.y,point.z);
+            polygon.world_box.extend(Eigen::Vector3f(World_point.x(),World_point.y(),World_point.z()));
+        }
+        polygon.index_id=boxes.size();
+        boxes.push_back(polygon.world_box);
+        cache_world_frame(polygon);
+    }
+    affordance_index.build(boxes);
+}
+
+void footstepPlanner::cache_world_frame(polygon_with_normals& polygon)
+{
+    polygon.world.reset(new world_frame_cache);
+    polygon.world->World_Camera=World_Camera;
+    const normal_points& Camera_normals=*polygon.normals;
+    normal_points& World_normals=polygon.world->normals;
+    World_normals.resize(Camera_normals.size());
+    for (unsigned int i=0; i<Camera_normals.size(); i++)
+    {
+        KDL::Vector World_point=World_Camera*KDL::Vector(Camera_normals.x[i],Camera_normals.y[i],Camera_normals.z[i]);
+        KDL::Vector World_normal=World_Camera.M*KDL::Vector(Camera_normals.normal_x[i],Camera_normals.normal_y[i],Camera_normals.normal_z[i]);
+        World_normals.x[i]=World_point.x(); World_normals.y[i]=World_point.y(); World_normals.z[i]=World_point.z();
+        World_normals.normal_x[i]=World_normal.x(); World_normals.normal_y[i]=World_normal.y(); World_normals.normal_z[i]=World_normal.z();
+    }
+    polygon.world->frames.resize(Camera_normals.size());
+    polygon.world->frame_ready.assign(Camera_normals.size(),0);
 }
 
 //Camera link
@@ -165,35 +243,75 @@ void footstepPlanner::setCurrentDirection(KDL::Vector direction)
     gs_utils.setCurrentDirection(direction);
 }
 
-void footstepPlanner::generate_frames_from_normals(const std::list< polygon_with_normals >& affordances, std::list< foot_with_joints >& steps)
+void footstepPlanner::generate_frames_from_normals(const std::list< polygon_with_normals >& affordances, candidate_store& steps)
 {
     int j=-1;
+    KDL::Vector World_DesiredDirection=World_Camera.M*Camera_DesiredDirection;
 
     for(auto const& item:affordances)
     {
         j++;
-        ROS_INFO("Polygon %d number of normals : %lu ",j,item.normals->size());
+        ROS_INFO("Polygon %d number of normals : %lu ",j,item.selection.size());
 
-        for(unsigned int i=0; i<item.normals->size(); i++)
+        // the frames on the normals depend only on the desired direction, they are kept until it changes
+        world_frame_cache& cache=*item.world;
+        if (!(cache.frames_direction==Camera_DesiredDirection))
         {
-            KDL::Frame plane_frame=createFramesFromNormal((*item.normals)[i]);
-            int k=-1;
-            for (double angle=min_angle;angle<=max_angle;angle=angle+angle_step) 
+            cache.frame_ready.assign(cache.frame_ready.size(),0);
+            cache.frames_direction=Camera_DesiredDirection;
+        }
+
+        // the missing frames are built in a single batch on the world frame normals
+        missing_frames.clear();
+        for (auto i:item.selection)
+            if (!cache.frame_ready[i])
             {
-                //double angle=0.0;
-                k++;
-                KDL::Frame Camera_MovingFoot;
-                KDL::Frame rotz;
-                rotz.M=KDL::Rotation::RotZ(angle);
-                Camera_MovingFoot=plane_frame*rotz;
-                KDL::JntArray joints_position;
-                foot_with_joints temp;
-                temp.index=(long int)&temp;
-                temp.World_MovingFoot=World_Camera*Camera_MovingFoot;
-                temp.joints=joints_position;
-                steps.push_back(std::move(temp));
+                missing_frames.push_back(i);
+                cache.frame_ready[i]=1;
             }
-        }
+        gs_utils.createFramesFromNormals(cache.normals,missing_frames,World_DesiredDirection,cache.frames);
+    }
+    
+    // only the candidates reachable from the stance foot and fitting on their plane are instantiated
+    candidates.setSweep(min_angle,max_angle,angle_step);
+    candidates.setReach(max_step_distance,max_step_yaw);
+    candidates.setFoot(foot_length,foot_width);
+    candidates.reset(affordances,World_Camera,World_StanceFoot);
+    steps.clear();
+    KDL::Frame World_MovingFoot;
+    while (candidates.next(World_MovingFoot))
+        steps.add().World_MovingFoot=World_MovingFoot;
+    ROS_INFO("Number of frames not reachable from the stance foot : %lu ",candidates.getUnreachable());
+    ROS_INFO("Number of frames where the foot does not fit : %lu ",candidates.getNotFitting());
+}
+
+void footstepPlanner::index_filtering(std::list< polygon_with_normals >& affordances, bool left)
+{
+    if (affordance_index.empty())
+        return;
+    
+    // the windows of the coordinate filters on world frame points
+    KDL::Frame StanceFoot_World = World_StanceFoot.Inverse();
+    std::vector<slab> slabs;
+    for (auto filter:filter_by_coordinates)
+    {
+        coordinate_predicate window=filter->get_predicate(left,StanceFoot_World);
+        slab s;
+        s.normal=Eigen::Vector3f(window.plane[0],window.plane[1],window.plane[2]);
+        s.offset=window.plane[3];
+        s.min=window.axis_min;
+        s.max=window.axis_max;
+        slabs.push_back(s);
+    }
+    affordance_index.query(slabs,index_candidates);
+    
+    // polygons not in the index are left to the other filters
+    for (auto it=affordances.begin(); it!=affordances.end();)
+    {
+        if (it->index_id>=0 && it->index_id<(int)index_candidates.size() && !index_candidates[it->index_id])
+            it=affordances.erase(it);
+        else
+            ++it;
     }
 }
 
@@ -201,6 +319,13 @@ void footstepPlanner::geometric_filtering(std::list< polygon_with_normals >& aff
 {
     ROS_INFO("Number of affordances: %lu ",affordances.size());
     
+    index_filtering(affordances,left);
+    ROS_INFO("Number of affordances in the stance foot window : %lu ",affordances.size());
+    
+    // every step starts from all the normals of the capture
+    for (auto& polygon:affordances)
+        polygon.selectAll();
+    
     filter_by_tilt->set_world(World_Camera);
     filter_by_tilt->filter_normals(affordances);   //filter on the tilt of the normal
     
@@ -221,17 +346,22 @@ void footstepPlanner::geometric_filtering(std::list< polygon_with_normals >& aff
     
     ROS_INFO("Number of affordances after geometric filter XYZ on borders: %lu ",affordances.size());
     
-    filter_by_coordinates.at(0)->filter_points(affordances,left);   //filter on x
-    filter_by_coordinates.at(1)->filter_points(affordances,left);   //filter on y
-    filter_by_coordinates.at(2)->filter_points(affordances,left);   //filter on z
-    
-    filter_by_tilt->filter_single_normals(affordances);
+    // the normals are filtered in the world frame cache, only the stance foot transform changes between the steps
+    for (auto& polygon:affordances)
+        if (!polygon.world || !KDL::Equal(polygon.world->World_Camera,World_Camera))
+            cache_world_frame(polygon);
+    KDL::Frame StanceFoot_World = World_StanceFoot.Inverse();
     
-    filter_to_avoid_foot.set_stance_foot(StanceFoot_Camera);
-    filter_to_avoid_foot.filter_points(affordances,left);
+    //filter on x, y, z, on the foot collision and on the tilt of every normal, in a single pass
+    auto keep=make_all_of(filter_by_coordinates.at(0)->get_predicate(left,StanceFoot_World),
+                          filter_by_coordinates.at(1)->get_predicate(left,StanceFoot_World),
+                          filter_by_coordinates.at(2)->get_predicate(left,StanceFoot_World),
+                          filter_to_avoid_foot.get_predicate(left,StanceFoot_World),
+                          filter_by_tilt->get_single_normal_predicate(KDL::Rotation::Identity()));
+    filter_points(affordances,keep,true);
 }
 
-void footstepPlanner::kinematic_filtering(std::list<foot_with_joints>& steps, bool left)
+void footstepPlanner::kinematic_filtering(candidate_store& steps, bool left)
 {
     kinematicFilter.setLeftRightFoot(left);
     kinematicFilter.setWorld_StanceFoot(World_StanceFoot);
@@ -241,7 +371,7 @@ void footstepPlanner::kinematic_filtering(std::list<foot_with_joints>& steps, bo
     
 }
 
-void footstepPlanner::dynamic_filtering(std::list<foot_with_joints>& steps, bool left)
+void footstepPlanner::dynamic_filtering(candidate_store& steps, bool left)
 {
     comFilter.setLeftRightFoot(left);
     comFilter.setWorld_StanceFoot(World_StanceFoot);
@@ -273,25 +403,25 @@ std::list<foot_with_joints > footstepPlanner::getFeasibleCentroids(std::list< po
 
     geometric_filtering(affordances,left); //GEOMETRIC FILTER
 
-    std::list<foot_with_joints> steps;
-    
-    generate_frames_from_normals(affordances,steps); //generating kdl frames to place foot
+    generate_frames_from_normals(affordances,candidate_steps); //generating kdl frames to place foot
     color_filtered=1;
-    if(steps.size()<=1000) ros_pub->publish_filtered_frames(steps,World_Camera,color_filtered);
-    ROS_INFO("Number of steps after geometric filter: %lu ",steps.size()); 
+    if(candidate_steps.size()<=1000) ros_pub->publish_filtered_frames(candidate_steps,World_Camera,color_filtered);
+    ROS_INFO("Number of steps after geometric filter: %lu ",candidate_steps.size()); 
 
-    kinematic_filtering(steps,left); //KINEMATIC FILTER
+    kinematic_filtering(candidate_steps,left); //KINEMATIC FILTER
     color_filtered=2;
-    if(steps.size()<=1000) ros_pub->publish_filtered_frames(steps,World_Camera,color_filtered);
-    ROS_INFO("Number of steps after kinematic filter: %lu ",steps.size());  
+    if(candidate_steps.size()<=1000) ros_pub->publish_filtered_frames(candidate_steps,World_Camera,color_filtered);
+    ROS_INFO("Number of steps after kinematic filter: %lu ",candidate_steps.size());  
     auto time=ros::Time::now();
-    dynamic_filtering(steps,left); //DYNAMIC FILTER
+    dynamic_filtering(candidate_steps,left); //DYNAMIC FILTER
     color_filtered=3;
-    if(steps.size()<=1000) ros_pub->publish_filtered_frames(steps,World_Camera,color_filtered);
+    if(candidate_steps.size()<=1000) ros_pub->publish_filtered_frames(candidate_steps,World_Camera,color_filtered);
     std::cout<<"time after dynamic filter"<<time<<std::endl;
-    ROS_INFO("Number of steps after dynamic filter: %lu ",steps.size());
+    ROS_INFO("Number of steps after dynamic filter: %lu ",candidate_steps.size());
 
-    return steps;
+    std::list<foot_with_joints> result;
+    toList(candidate_steps,result);
+    return result;
 }
 
 std::list<foot_with_joints> footstepPlanner::single_check(KDL::Frame left_foot, KDL::Frame right_foot, bool only_ik, bool move, bool left)
@@ -302,18 +432,19 @@ std::list<foot_with_joints> footstepPlanner::single_check(KDL::Frame left_foot,
     
     World_StanceFoot = (left)?left_foot:right_foot;
     
-    std::list<foot_with_joints> list;
-    foot_with_joints fwj;
-    fwj.World_StanceFoot = (left)?left_foot:right_foot;
-    fwj.World_MovingFoot = (left)?right_foot:left_foot;
-    list.insert(list.begin(),fwj);
+    candidate_steps.clear();
+    candidate& step=candidate_steps.add();
+    step.World_StanceFoot = (left)?left_foot:right_foot;
+    step.World_MovingFoot = (left)?right_foot:left_foot;
     
-    kinematic_filtering(list,left);
+    kinematic_filtering(candidate_steps,left);
         
-    if(!only_ik) dynamic_filtering(list,left);
+    if(!only_ik) dynamic_filtering(candidate_steps,left);
     
     if(!move) World_StanceFoot=tmp_World_StanceFoot;
     
+    std::list<foot_with_joints> list;
+    toList(candidate_steps,list);
     return list;
 }
 
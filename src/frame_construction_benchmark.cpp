@@ -0,0 +1,74 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+// compares the frames built one normal at a time with the batch construction, usage: frame_construction_benchmark [normals] [iterations]
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include "gram_schmidt.h"
+#include "batch_kernels.h"
+
+using namespace planner;
+
+int main(int argc, char** argv)
+{
+    int normals=argc>1?atoi(argv[1]):100000;
+    int iterations=argc>2?atoi(argv[2]):20;
+    
+    // normals around the vertical, some of them along the desired direction
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> coordinate(-1.0,1.0), tilt(-0.6,0.6);
+    normal_points points;
+    points.reserve(normals);
+    std::vector<unsigned int> indices;
+    for (int i=0; i<normals; i++)
+    {
+        pcl::PointXYZRGBNormal point;
+        point.x=coordinate(generator); point.y=coordinate(generator); point.z=0.2*coordinate(generator);
+        KDL::Vector normal(tilt(generator),tilt(generator),1.0);
+        if (i%1000==0) normal=KDL::Vector(1,0,0);
+        normal.Normalize();
+        point.normal_x=normal.x(); point.normal_y=normal.y(); point.normal_z=normal.z();
+        points.push_back(point);
+        indices.push_back(i);
+    }
+    KDL::Vector direction(1,0,0);
+    std::cout<<normals<<" normals, "<<iterations<<" iterations, "<<batch_kernels_isa()<<" kernels"<<std::endl;
+    
+    gram_schmidt gs_utils;
+    gs_utils.setCurrentDirection(direction);
+    std::vector<KDL::Frame> single_frames(normals), batch_frames(normals);
+    double single_time=0, batch_time=0;
+    for (int it=0; it<iterations; it++)
+    {
+        auto start=std::chrono::steady_clock::now();
+        for (int i=0; i<normals; i++)
+            single_frames[i]=gs_utils.createFramesFromNormal(points.at(i));
+        single_time+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        
+        start=std::chrono::steady_clock::now();
+        gs_utils.createFramesFromNormals(points,indices,direction,batch_frames);
+        batch_time+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    }
+    
+    double max_difference=0;
+    for (int i=0; i<normals; i++)
+        for (int j=0; j<9; j++)
+            max_difference=std::max(max_difference,std::abs(single_frames[i].M.data[j]-batch_frames[i].M.data[j]));
+    std::cout<<"one normal at a time: "<<single_time/iterations*1000<<" ms"<<std::endl;
+    std::cout<<"batch: "<<batch_time/iterations*1000<<" ms"<<std::endl;
+    std::cout<<"largest difference of the rotations: "<<max_difference<<std::endl;
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+// compares the chain of geometric filters on the normals with the fused single pass, usage: geometric_filter_benchmark [polygons] [normals per polygon] [iterations]
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include "coordinate_filter.h"
+#include "tilt_filter.h"
+#include "foot_collision_filter.h"
+#include "point_predicates.h"
+
+using namespace planner;
+
+static std::list<polygon_with_normals> select_all(const std::list<polygon_with_normals>& data)
+{
+    std::list<polygon_with_normals> copy(data);
+    for (auto& polygon:copy)
+        polygon.selectAll();
+    return copy;
+}
+
+int main(int argc, char** argv)
+{
+    int polygons=argc>1?atoi(argv[1]):50;
+    int normals=argc>2?atoi(argv[2]):2000;
+    int iterations=argc>3?atoi(argv[3]):50;
+    bool left=true;
+    
+    // camera looking down and forward, about one meter above the stance foot
+    KDL::Frame World_Camera(KDL::Rotation::RPY(-2.2,0,-M_PI/2),KDL::Vector(0,0,1.2));
+    KDL::Frame World_StanceFoot(KDL::Rotation::RotZ(0.1),KDL::Vector(0,0.1,0));
+    KDL::Frame StanceFoot_Camera=World_StanceFoot.Inverse()*World_Camera;
+    
+    std::mt19937 generator(0);
+    std::uniform_real_distribution<float> coordinate(-1.0,1.0), tilt(-0.6,0.6);
+    std::list<polygon_with_normals> data;
+    for (int p=0; p<polygons; p++)
+    {
+        polygon_with_normals polygon;
+        polygon.normals.reset(new normal_points);
+        polygon.normals->reserve(normals);
+        for (int i=0; i<normals; i++)
+        {
+            pcl::PointXYZRGBNormal point;
+            KDL::Vector Camera_point=World_Camera.Inverse()*KDL::Vector(coordinate(generator),coordinate(generator),0.2*coordinate(generator));
+            KDL::Vector Camera_normal=World_Camera.M.Inverse()*KDL::Vector(tilt(generator),tilt(generator),1.0);
+            Camera_normal.Normalize();
+            point.x=Camera_point.x(); point.y=Camera_point.y(); point.z=Camera_point.z();
+            point.normal_x=Camera_normal.x(); point.normal_y=Camera_normal.y(); point.normal_z=Camera_normal.z();
+            polygon.normals->push_back(point);
+        }
+        data.push_back(polygon);
+    }
+    std::cout<<polygons<<" polygons, "<<normals<<" normals each, "<<iterations<<" iterations, "<<batch_kernels_isa()<<" kernels"<<std::endl;
+    
+    std::vector<coordinate_filter*> filter_by_coordinates;
+    filter_by_coordinates.push_back(new coordinate_filter(0,0.0,0.6));
+    filter_by_coordinates.push_back(new coordinate_filter(1,-0.6,0.1));
+    filter_by_coordinates.push_back(new coordinate_filter(2,-0.5,0.5));
+    tilt_filter* filter_by_tilt=new tilt_filter();
+    foot_collision_filter filter_to_avoid_foot;
+    for (auto filter:filter_by_coordinates)
+        filter->set_stance_foot(StanceFoot_Camera);
+    filter_by_tilt->set_world(World_Camera);
+    filter_to_avoid_foot.set_stance_foot(StanceFoot_Camera);
+    
+    // only the filtering is timed, every iteration starts from all the normals selected
+    double chain_time=0, fused_time=0;
+    std::list<polygon_with_normals> chain_output, fused_output;
+    for (int it=0; it<iterations; it++)
+    {
+        chain_output=select_all(data);
+        auto start=std::chrono::steady_clock::now();
+        for (auto filter:filter_by_coordinates)
+            filter->filter_points(chain_output,left);
+        filter_by_tilt->filter_single_normals(chain_output);
+        filter_to_avoid_foot.filter_points(chain_output,left);
+        chain_time+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        
+        fused_output=select_all(data);
+        start=std::chrono::steady_clock::now();
+        auto keep=make_all_of(filter_by_coordinates.at(0)->get_predicate(left),
+                              filter_by_coordinates.at(1)->get_predicate(left),
+                              filter_by_coordinates.at(2)->get_predicate(left),
+                              filter_to_avoid_foot.get_predicate(left),
+                              filter_by_tilt->get_single_normal_predicate());
+        filter_points(fused_output,keep);
+        fused_time+=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+    }
+    
+    unsigned long chain_kept=0, fused_kept=0, different=0;
+    for (auto c=chain_output.begin(), f=fused_output.begin(); c!=chain_output.end(); ++c, ++f)
+    {
+        chain_kept+=c->selection.size();
+        fused_kept+=f->selection.size();
+        if (c->selection!=f->selection)
+            different++;
+    }
+    std::cout<<"chain of filters: "<<chain_time/iterations*1000<<" ms, "<<chain_kept<<" normals kept"<<std::endl;
+    std::cout<<"fused filter: "<<fused_time/iterations*1000<<" ms, "<<fused_kept<<" normals kept"<<std::endl;
+    std::cout<<"polygons with different output: "<<different<<std::endl;
+    return 0;
+}
@@ -13,10 +13,10 @@
  * limitations under the License.*/
 
 #include "gram_schmidt.h"
+#include "batch_kernels.h"
 
 #include<iostream>
 #include<Eigen/Core>
-#include<Eigen/SVD>
 
 
 gram_schmidt::gram_schmidt()
@@ -27,89 +27,62 @@ void gram_schmidt::setCurrentDirection(KDL::Vector direction)
 {
     vd<<direction.x(),direction.y(),direction.z();
     direction_set=true;
-    
 }
 
 KDL::Frame gram_schmidt::createFramesFromNormal(pcl::PointXYZRGBNormal p_normal)
 {	
-    // Creation of vector field v1,v2,v3
-    Eigen::Vector3d v1(p_normal.normal_x,p_normal.normal_y,p_normal.normal_z);
-    int imin = 0;
-    for(int i=0; i<3; ++i)
-      if(std::abs(v1[i]) < std::abs(v1[imin]))
-        imin = i;  
-    
-    Eigen::Vector3d v2(0,0,0);
-    float dt = v1[imin];
-    
-    v2[imin] = 1;
-    for(int i=0;i<3;i++)
-      v2[i] -= dt*v1[i];
-    
-    Eigen::Vector3d v3(v1.cross(v2));
-    
-    // Gram-Schmidt orthogonalization of the vector field 
-    Eigen::Vector3d u1(v1);
-    Eigen::Vector3d u2(v2-proj_u(v2,u1));
-    Eigen::Vector3d u3(v3-proj_u(v3,u1)-proj_u(v3,u2));
-    
-    // MGS TODO ...   
+    Eigen::Vector3d e1(p_normal.normal_x,p_normal.normal_y,p_normal.normal_z);
+    e1.normalize();
     
-    // Orthonormal field given p_normal
-    Eigen::Vector3d e1(u1/u1.norm());
-    Eigen::Vector3d e2(u2/u2.norm());
-    Eigen::Vector3d e3(u3/u3.norm());
-
-    Eigen::MatrixXd A(3,2);
-    for (int i=0;i<3;i++){
-	A(i,0)=e2[i];
-	A(i,1)=e3[i];
+    // the desired direction projected on the plane, the world x (or y) axis when it is along the normal
+    Eigen::Vector3d xd=vd-e1.dot(vd)*e1;
+    if (xd.squaredNorm()<=1e-12*vd.squaredNorm())
+    {
+        Eigen::Vector3d fallback=std::abs(e1[0])<0.9?Eigen::Vector3d::UnitX():Eigen::Vector3d::UnitY();
+        xd=fallback-e1.dot(fallback)*e1;
     }
+    
+    Eigen::Vector3d e3(xd.normalized());
+    Eigen::Vector3d e2(e1.cross(e3));
 
-    // new xd versor || to vd
-    Eigen::Vector3d xd;
-    auto B = pseudoInverse(A);
-    auto C = A*B;
-    xd = C*vd;
-
-    e3 = xd/xd.norm();
-    e2 = e1.cross(e3); 
-
-    Eigen::Matrix3d Q(3,3);
-    Q << e3, e2, e1;
-
-    // create a KDL frame
-    frame_normal.p[0] = p_normal.x;
-    frame_normal.p[1] = p_normal.y;
-    frame_normal.p[2] = p_normal.z;
-
-    for (int i=0;i<3;i++)
-      for (int j=0;j<3;j++)
-	frame_normal.M.data[i*3+j] = Q(i,j);
-   
+    KDL::Frame frame_normal;
+    frame_normal.p=KDL::Vector(p_normal.x,p_normal.y,p_normal.z);
+    frame_normal.M=KDL::Rotation(KDL::Vector(e3[0],e3[1],e3[2]),KDL::Vector(e2[0],e2[1],e2[2]),KDL::Vector(e1[0],e1[1],e1[2]));
     return frame_normal;
 }
 
-Eigen::Vector3d gram_schmidt::proj_u(Eigen::Vector3d v, Eigen::Vector3d u)
+void gram_schmidt::createFramesFromNormals(const planner::normal_points& normals, const std::vector<unsigned int>& indices, const KDL::Vector& direction, std::vector<KDL::Frame>& frames)
 {
-  return (u.dot(v))*u/(u.dot(u));
+    unsigned int n=indices.size();
+    for (int k=0; k<3; k++)
+        gathered[k].resize(n);
+    for (int k=0; k<9; k++)
+        axes[k].resize(n);
+    for (unsigned int j=0; j<n; j++)
+    {
+        gathered[0][j]=normals.normal_x[indices[j]];
+        gathered[1][j]=normals.normal_y[indices[j]];
+        gathered[2][j]=normals.normal_z[indices[j]];
+    }
+    
+    float batch_direction[3]={(float)direction.x(),(float)direction.y(),(float)direction.z()};
+    float* const x_axis[3]={axes[0].data(),axes[1].data(),axes[2].data()};
+    float* const y_axis[3]={axes[3].data(),axes[4].data(),axes[5].data()};
+    float* const z_axis[3]={axes[6].data(),axes[7].data(),axes[8].data()};
+    planner::plane_frame_batch(gathered[0].data(),gathered[1].data(),gathered[2].data(),n,batch_direction,x_axis,y_axis,z_axis);
+    
+    for (unsigned int j=0; j<n; j++)
+    {
+        unsigned int i=indices[j];
+        KDL::Frame& frame=frames[i];
+        frame.p=KDL::Vector(normals.x[i],normals.y[i],normals.z[i]);
+        frame.M=KDL::Rotation(axes[0][j],axes[3][j],axes[6][j],
+                              axes[1][j],axes[4][j],axes[7][j],
+                              axes[2][j],axes[5][j],axes[8][j]);
+    }
 }
 
 gram_schmidt::~gram_schmidt()
 {
 
 }
-
-template<typename _Matrix_Type_>
-_Matrix_Type_ gram_schmidt::pseudoInverse(const _Matrix_Type_ &a, double epsilon)
-{
-    Eigen::JacobiSVD< _Matrix_Type_ > svd(a ,Eigen::ComputeThinU | Eigen::ComputeThinV);
-    double tolerance = epsilon * std::max(a.cols(), a.rows())*svd.singularValues().array().abs()(0);
-    return svd.matrixV() *
-    (svd.singularValues().array().abs() >tolerance).
-    select(svd.singularValues().array().inverse(),0).
-    matrix().asDiagonal() * 
-    svd.matrixU().adjoint();
-    
-}
-
@@ -57,52 +57,44 @@ chain_and_solvers kinematic_filter::getJointChain()
     return current_chain;
 }
 
-bool kinematic_filter::filter(std::list<foot_with_joints> &data)
+bool kinematic_filter::filter(candidate_store &data)
 {
     jnt_pos_in=kinematics.lwr_legs.joints_value;
+    jnt_pos_out.resize(kinematics.rwl_legs.chain.getNrOfJoints());
+    stance_jnt_pos.resize(kinematics.wl_leg.chain.getNrOfJoints());
     
-    for (auto single_step=data.begin();single_step!=data.end();)
+    data.compact([&](candidate& single_step)
     {
-        auto StanceFoot_MovingFoot=StanceFoot_World*single_step->World_MovingFoot;
-        if (!frame_is_reachable(StanceFoot_MovingFoot,single_step->joints))
-            single_step=data.erase(single_step);
-        else
-        {
-            single_step->World_StanceFoot=World_StanceFoot;
-            KDL::Frame StanceFoot_Waist;
-            KDL::JntArray temp(kinematics.wl_leg.chain.getNrOfJoints());
-            for (int i=0;i<temp.rows();i++)
-                temp(i)=single_step->joints(i);
-            current_fk_solver->JntToCart(temp,StanceFoot_Waist);
-            single_step->World_Waist=World_StanceFoot*StanceFoot_Waist;
+        auto StanceFoot_MovingFoot=StanceFoot_World*single_step.World_MovingFoot;
+        if (!frame_is_reachable(StanceFoot_MovingFoot,jnt_pos_out))
+            return false;
+        single_step.joints.assign(jnt_pos_out);
+        single_step.World_StanceFoot=World_StanceFoot;
+        KDL::Frame StanceFoot_Waist;
+        for (int i=0;i<stance_jnt_pos.rows();i++)
+            stance_jnt_pos(i)=jnt_pos_out(i);
+        current_fk_solver->JntToCart(stance_jnt_pos,StanceFoot_Waist);
+        single_step.World_Waist=World_StanceFoot*StanceFoot_Waist;
 #ifdef KINEMATICS_OUTPUT
-            tf::Transform current_robot_transform;
-            tf::transformKDLToTF(single_step->World_Waist,current_robot_transform);
-            static tf::TransformBroadcaster br;
-            br.sendTransform(tf::StampedTransform(current_robot_transform, ros::Time::now(),  "world","KNEW_WAIST"));
-            tf::Transform current_moving_foot_transform;
-            tf::transformKDLToTF(World_StanceFoot*StanceFoot_MovingFoot,current_moving_foot_transform);
-            br.sendTransform(tf::StampedTransform(current_moving_foot_transform, ros::Time::now(),  "world","Kmoving_foot"));
-            tf::Transform fucking_transform;
-            tf::transformKDLToTF(World_StanceFoot,fucking_transform);
-            br.sendTransform(tf::StampedTransform(fucking_transform, ros::Time::now(), "world", "Kstance_foot"));
+        tf::Transform current_robot_transform;
+        tf::transformKDLToTF(single_step.World_Waist,current_robot_transform);
+        static tf::TransformBroadcaster br;
+        br.sendTransform(tf::StampedTransform(current_robot_transform, ros::Time::now(),  "world","KNEW_WAIST"));
+        tf::Transform current_moving_foot_transform;
+        tf::transformKDLToTF(World_StanceFoot*StanceFoot_MovingFoot,current_moving_foot_transform);
+        br.sendTransform(tf::StampedTransform(current_moving_foot_transform, ros::Time::now(),  "world","Kmoving_foot"));
+        tf::Transform fucking_transform;
+        tf::transformKDLToTF(World_StanceFoot,fucking_transform);
+        br.sendTransform(tf::StampedTransform(fucking_transform, ros::Time::now(), "world", "Kstance_foot"));
 #endif
-            single_step++;
-        }
-    }
+        return true;
+    });
     return true;
 }
 
 bool kinematic_filter::frame_is_reachable(const KDL::Frame& StanceFoot_MovingFoot, KDL::JntArray& jnt_pos)
 {
     SetToZero(jnt_pos_in);
-    KDL::JntArray jnt_pos_out(kinematics.rwl_legs.chain.getNrOfJoints());
-    int ik_valid = current_ik_solver->CartToJnt(jnt_pos_in, StanceFoot_MovingFoot, jnt_pos_out);
-    if (ik_valid>=0)
-    {
-        jnt_pos=jnt_pos_out;
-        return true;
-    }
-
-    return false;
+    int ik_valid = current_ik_solver->CartToJnt(jnt_pos_in, StanceFoot_MovingFoot, jnt_pos);
+    return ik_valid>=0;
 }
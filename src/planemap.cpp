@@ -0,0 +1,191 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "planemap.h"
+#include "voxel_key.h"
+#include <cmath>
+#include <algorithm>
+
+using namespace planner;
+
+planeMap::planeMap():map_voxel_size_(0.05),normal_threshold_(0.985),change_fraction_(0.05),min_voxel_points_(3),world_camera_set(false),next_plane_id(0),pending(false)
+{
+}
+
+void planeMap::setParams(double map_voxel_size_, double normal_threshold_, double change_fraction_, int min_voxel_points_)
+{
+    if (map_voxel_size_!=this->map_voxel_size_)
+        reset();
+    this->map_voxel_size_=map_voxel_size_;
+    this->normal_threshold_=normal_threshold_;
+    this->change_fraction_=change_fraction_;
+    this->min_voxel_points_=min_voxel_points_;
+}
+
+void planeMap::reset()
+{
+    voxels.clear();
+    planes.clear();
+    reused_planes.clear();
+    world_camera_set=false;
+    pending=false;
+}
+
+uint64_t planeMap::key(const Eigen::Vector3f& World_point) const
+{
+    double inverse_size=1.0/map_voxel_size_;
+    return voxel_key(voxel_coordinate(World_point[0],inverse_size),voxel_coordinate(World_point[1],inverse_size),voxel_coordinate(World_point[2],inverse_size));
+}
+
+void planeMap::removePlane(int id)
+{
+    auto plane=planes.find(id);
+    if (plane==planes.end()) return;
+    for (auto k:plane->second.voxels)
+        voxels.erase(k);
+    planes.erase(plane);
+}
+
+void planeMap::update(const pcl::PointCloud< pcl::PointXYZRGBNormal >& cloud, const Eigen::Affine3f& World_Camera, std::vector< bool >& reprocess)
+{
+    // polygons are in the camera frame, they can be reused only if the camera did not move
+    if (!world_camera_set || !World_Camera.isApprox(this->World_Camera,1e-5))
+    {
+        reset();
+        this->World_Camera=World_Camera;
+        world_camera_set=true;
+    }
+    
+    int N=cloud.size();
+    observed.clear();
+    point_keys.resize(N);
+    point_normals.resize(N);
+    for (int p=0;p<N;p++)
+    {
+        Eigen::Vector3f World_point=World_Camera*cloud.points[p].getVector3fMap();
+        point_normals[p]=World_Camera.linear()*cloud.points[p].getNormalVector3fMap();
+        point_keys[p]=key(World_point);
+        auto voxel=observed.emplace(point_keys[p],observed_voxel()).first;
+        if (voxel->second.count==0)
+            voxel->second.normal_sum.setZero();
+        voxel->second.normal_sum+=point_normals[p];
+        voxel->second.count++;
+    }
+    
+    // count for each plane how many of its voxels changed
+    std::unordered_map<int,int> changes;
+    for (auto& voxel:observed)
+    {
+        if (voxel.second.count<min_voxel_points_)
+            continue;
+        auto known=voxels.find(voxel.first);
+        if (known!=voxels.end())
+        {
+            Eigen::Vector3f normal=voxel.second.normal_sum.normalized();
+            if (fabs(normal.dot(known->second.normal))<normal_threshold_)
+                changes[known->second.plane]++;
+            continue;
+        }
+        // a new voxel touching a plane may extend it or lie on it
+        int64_t i,j,k;
+        voxel_coordinates(voxel.first,i,j,k);
+        std::vector<int> touched;
+        for (int di=-1;di<=1;di++)
+            for (int dj=-1;dj<=1;dj++)
+                for (int dk=-1;dk<=1;dk++)
+                {
+                    auto neighbour=voxels.find(voxel_key(i+di,j+dj,k+dk));
+                    if (neighbour!=voxels.end() && std::find(touched.begin(),touched.end(),neighbour->second.plane)==touched.end())
+                        touched.push_back(neighbour->second.plane);
+                }
+        for (auto id:touched)
+            changes[id]++;
+    }
+    
+    reused_planes.clear();
+    std::vector<int> removed;
+    for (auto& plane:planes)
+    {
+        int changed=changes[plane.first];
+        // voxels that are not seen anymore are changes too
+        for (auto k:plane.second.voxels)
+        {
+            auto voxel=observed.find(k);
+            if (voxel==observed.end() || voxel->second.count<min_voxel_points_)
+                changed++;
+        }
+        if (changed>change_fraction_*plane.second.voxels.size())
+            removed.push_back(plane.first);
+        else
+            reused_planes.push_back(plane.first);
+    }
+    for (auto id:removed)
+        removePlane(id);
+    
+    // points lying on a plane that did not change are not clustered again
+    reprocess.assign(N,true);
+    for (int p=0;p<N;p++)
+    {
+        auto voxel=voxels.find(point_keys[p]);
+        if (voxel==voxels.end())
+            continue;
+        if (fabs(point_normals[p].dot(planes[voxel->second.plane].normal))>=normal_threshold_)
+            reprocess[p]=false;
+    }
+    pending=true;
+}
+
+void planeMap::insertPlanes(spatialIndex& index, const std::list< polygon_with_normals >& polygons)
+{
+    if (!pending)
+        return;
+    pending=false;
+    const std::vector<pcl::PointIndices>& clusters=index.getClusters();
+    if (clusters.size()!=polygons.size() || point_keys.size()!=index.getCloud()->size())
+    {
+        // something went wrong in the border extraction, the next capture will be processed from scratch
+        reset();
+        return;
+    }
+    
+    auto polygon=polygons.begin();
+    for (unsigned int c=0;c<clusters.size();c++,++polygon)
+    {
+        int id=next_plane_id++;
+        map_plane& plane=planes[id];
+        plane.polygon=*polygon;
+        plane.normal=(World_Camera.linear()*polygon->average_normal.getNormalVector3fMap()).normalized();
+        for (auto p:clusters[c].indices)
+        {
+            auto voxel=observed.find(point_keys[p]);
+            if (voxel->second.count<min_voxel_points_)
+                continue;
+            // voxels shared by two planes belong to the first one
+            auto inserted=voxels.emplace(point_keys[p],map_voxel());
+            if (!inserted.second)
+                continue;
+            inserted.first->second.normal=voxel->second.normal_sum.normalized();
+            inserted.first->second.plane=id;
+            plane.voxels.push_back(point_keys[p]);
+        }
+        if (plane.voxels.empty())
+            planes.erase(id);
+    }
+}
+
+void planeMap::appendReusedPolygons(std::list< polygon_with_normals >& polygons)
+{
+    for (auto id:reused_planes)
+        polygons.push_back(planes[id].polygon);
+}
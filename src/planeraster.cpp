@@ -0,0 +1,224 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "planeraster.h"
+#include <pcl/features/normal_3d.h>
+#include <pcl/common/centroid.h>
+#include <Eigen/StdVector>
+#include <cfloat>
+#include <cmath>
+
+using namespace planner;
+
+// squared euclidean distance transform of a sampled function along one line (Felzenszwalb and Huttenlocher)
+static void distance_transform_1d(const double* f, int n, int stride, double* d, std::vector<int>& v, std::vector<double>& z)
+{
+    v.resize(n);
+    z.resize(n+1);
+    int k=0;
+    v[0]=0;
+    z[0]=-DBL_MAX;
+    z[1]=DBL_MAX;
+    for (int q=1; q<n; q++)
+    {
+        double s=((f[q*stride]+q*q)-(f[v[k]*stride]+v[k]*v[k]))/(2*q-2*v[k]);
+        while (s<=z[k])
+        {
+            k--;
+            s=((f[q*stride]+q*q)-(f[v[k]*stride]+v[k]*v[k]))/(2*q-2*v[k]);
+        }
+        k++;
+        v[k]=q;
+        z[k]=s;
+        z[k+1]=DBL_MAX;
+    }
+    k=0;
+    for (int q=0; q<n; q++)
+    {
+        while (z[k+1]<q) k++;
+        d[q*stride]=(q-v[k])*(q-v[k])+f[v[k]*stride];
+    }
+}
+
+planeRaster::planeRaster():cell_size(0.01),width(0),height(0)
+{
+}
+
+void planeRaster::build(const pcl::PointCloud< pcl::PointXYZRGBNormal >& cluster, double cell_size)
+{
+    this->cell_size=cell_size;
+    width=height=0;
+    cells.clear();
+    clearance.clear();
+    if (cluster.empty())
+        return;
+    
+    // plane frame of the cluster
+    Eigen::Vector4f plane;
+    Eigen::Vector4f centroid;
+    float curv;
+    pcl::computePointNormal(cluster,plane,curv);
+    pcl::compute3DCentroid(cluster,centroid);
+    normal=plane.head<3>().normalized();
+    u=normal.unitOrthogonal();
+    v=normal.cross(u);
+    origin=centroid.head<3>();
+    
+    std::vector<Eigen::Vector2f, Eigen::aligned_allocator<Eigen::Vector2f> > projected(cluster.size());
+    min=Eigen::Vector2f(FLT_MAX,FLT_MAX);
+    Eigen::Vector2f max(-FLT_MAX,-FLT_MAX);
+    for (unsigned int i=0; i<cluster.size(); i++)
+    {
+        Eigen::Vector3f p=cluster.points[i].getVector3fMap()-origin;
+        projected[i]=Eigen::Vector2f(p.dot(u),p.dot(v));
+        min=min.cwiseMin(projected[i]);
+        max=max.cwiseMax(projected[i]);
+    }
+    // points fall in the middle of their cells, so the contour is half a cell out of them on every side
+    min-=Eigen::Vector2f::Constant(cell_size/2);
+    width=(int)floor((max[0]-min[0])/cell_size)+3;
+    height=(int)floor((max[1]-min[1])/cell_size)+3;
+    std::vector<unsigned char> grid(width*height,0);
+    for (auto& p:projected)
+        grid[((int)floor((p[1]-min[1])/cell_size)+1)*width+(int)floor((p[0]-min[0])/cell_size)+1]=1;
+    
+    // closing (dilation and erosion) fills the holes left by the downsampling
+    std::vector<unsigned char> dilated(width*height,0);
+    for (int y=1; y<height-1; y++)
+        for (int x=1; x<width-1; x++)
+            for (int k=-1; k<=1 && !dilated[y*width+x]; k++)
+                for (int h=-1; h<=1; h++)
+                    if (grid[(y+k)*width+x+h]) {dilated[y*width+x]=1; break;}
+    for (int y=1; y<height-1; y++)
+        for (int x=1; x<width-1; x++)
+        {
+            bool full=true;
+            for (int k=-1; k<=1 && full; k++)
+                for (int h=-1; h<=1; h++)
+                    if (!dilated[(y+k)*width+x+h]) {full=false; break;}
+            grid[y*width+x]=full||grid[y*width+x]; // cells on the padding are never eroded
+        }
+    cells.swap(grid);
+}
+
+int planeRaster::keepLargestBlob()
+{
+    std::vector<int> component(width*height,-1);
+    std::vector<int> stack;
+    int best=-1, best_size=0, start=-1;
+    for (int c=0, i=0; i<width*height; i++)
+    {
+        if (!cells[i] || component[i]>=0)
+            continue;
+        int size=0;
+        stack.push_back(i);
+        component[i]=c;
+        while (!stack.empty())
+        {
+            int j=stack.back();
+            stack.pop_back();
+            size++;
+            for (int k=-1; k<=1; k++)
+                for (int h=-1; h<=1; h++)
+                {
+                    int n=j+k*width+h;
+                    if (cells[n] && component[n]<0)
+                    {
+                        component[n]=c;
+                        stack.push_back(n);
+                    }
+                }
+        }
+        if (size>best_size)
+        {
+            best=c;
+            best_size=size;
+            start=i;
+        }
+        c++;
+    }
+    for (int i=0; i<width*height; i++)
+        cells[i]=(component[i]==best);
+    clearance.clear();
+    return start;
+}
+
+void planeRaster::computeClearance()
+{
+    // squared distance in cells from the nearest empty cell, first along the columns and then along the rows
+    // the padding leaves an empty cell on every line, so occupied cells only need a value bigger than any distance
+    double occupied_value=(double)(width+height)*(width+height);
+    std::vector<double> f(width*height);
+    for (int i=0; i<width*height; i++)
+        f[i]=cells[i]?occupied_value:0;
+    std::vector<double> columns(width*height);
+    std::vector<int> v;
+    std::vector<double> z;
+    for (int x=0; x<width; x++)
+        distance_transform_1d(&f[x],height,width,&columns[x],v,z);
+    for (int y=0; y<height; y++)
+        distance_transform_1d(&columns[y*width],width,1,&f[y*width],v,z);
+    clearance.resize(width*height);
+    for (int i=0; i<width*height; i++)
+        clearance[i]=(std::sqrt(f[i])-0.5)*cell_size;
+}
+
+Eigen::Vector3f planeRaster::corner(int x, int y) const
+{
+    return origin+u*(min[0]+(x-1)*cell_size)+v*(min[1]+(y-1)*cell_size);
+}
+
+float planeRaster::clearanceAt(const Eigen::Vector2f& p) const
+{
+    int x=(int)floor((p[0]-min[0])/cell_size)+1;
+    int y=(int)floor((p[1]-min[1])/cell_size)+1;
+    if (x<0 || y<0 || x>=width || y>=height)
+        return -1;
+    return clearance[y*width+x];
+}
+
+bool planeRaster::fits(const Eigen::Vector3f& point, const Eigen::Vector3f& heading, double foot_length, double foot_width) const
+{
+    if (clearance.empty())
+        return true;
+    Eigen::Vector3f p=point-origin;
+    Eigen::Vector2f center(p.dot(u),p.dot(v));
+    Eigen::Vector2f axis(heading.dot(u),heading.dot(v));
+    if (axis.norm()<1e-6)
+        return false;
+    axis.normalize();
+    if (foot_length<foot_width)
+    {
+        std::swap(foot_length,foot_width);
+        axis=Eigen::Vector2f(-axis[1],axis[0]);
+    }
+    // the clearance is 1-lipschitz, so a point is at most half a cell diagonal closer to the border than its cell center
+    float slack=cell_size*M_SQRT1_2;
+    float circumradius=std::sqrt(foot_length*foot_length+foot_width*foot_width)/2;
+    float center_clearance=clearanceAt(center)-slack;
+    if (center_clearance>=circumradius)
+        return true;
+    if (center_clearance<foot_width/2)
+        return false;
+    // the rectangle is covered by n disks centered on its axis, each one covering a foot_length/n x foot_width block
+    int n=(int)std::ceil(foot_length/foot_width);
+    float radius=std::sqrt(foot_width*foot_width/4+foot_length*foot_length/(4*n*n));
+    for (int i=0; i<n; i++)
+    {
+        Eigen::Vector2f disk=center+axis*(-foot_length/2+foot_length/n*(i+0.5));
+        if (clearanceAt(disk)-slack<radius)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,115 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "polygonbvh.h"
+#include <algorithm>
+
+using namespace planner;
+
+// boxes in a leaf
+#define BVH_LEAF_SIZE 4
+
+polygonBVH::polygonBVH()
+{
+}
+
+void polygonBVH::clear()
+{
+    nodes.clear();
+    order.clear();
+    boxes.clear();
+}
+
+void polygonBVH::build(const std::vector< Eigen::AlignedBox3f >& boxes)
+{
+    clear();
+    this->boxes=boxes;
+    if (boxes.empty())
+        return;
+    order.resize(boxes.size());
+    for (unsigned int i=0; i<order.size(); i++)
+        order[i]=i;
+    nodes.reserve(2*boxes.size()/BVH_LEAF_SIZE+1);
+    buildNode(0,order.size());
+}
+
+int polygonBVH::buildNode(int first, int count)
+{
+    int id=nodes.size();
+    nodes.push_back(node());
+    Eigen::AlignedBox3f box, centers;
+    for (int i=first; i<first+count; i++)
+    {
+        box.extend(boxes[order[i]]);
+        centers.extend(boxes[order[i]].center());
+    }
+    nodes[id].box=box;
+    nodes[id].first=first;
+    nodes[id].count=count;
+    nodes[id].right=-1;
+    if (count<=BVH_LEAF_SIZE)
+        return id;
+    
+    int axis;
+    centers.sizes().maxCoeff(&axis);
+    int half=count/2;
+    std::nth_element(order.begin()+first,order.begin()+first+half,order.begin()+first+count,[&](int a, int b)
+    {
+        return boxes[a].center()[axis]<boxes[b].center()[axis];
+    });
+    buildNode(first,half);
+    int right=buildNode(first+half,count-half);
+    nodes[id].count=0;
+    nodes[id].right=right;
+    return id;
+}
+
+bool polygonBVH::intersects(const Eigen::AlignedBox3f& box, const std::vector< slab >& slabs)
+{
+    Eigen::Vector3f center=box.center();
+    Eigen::Vector3f half=box.sizes()/2;
+    for (auto const& s:slabs)
+    {
+        // range of normal.p+offset on the box
+        float value=s.normal.dot(center)+s.offset;
+        float radius=s.normal.cwiseAbs().dot(half);
+        if (value+radius<s.min || value-radius>s.max)
+            return false;
+    }
+    return true;
+}
+
+void polygonBVH::query(const std::vector< slab >& slabs, std::vector< bool >& candidates) const
+{
+    candidates.assign(boxes.size(),false);
+    if (nodes.empty())
+        return;
+    int stack[64];
+    int top=0;
+    stack[top++]=0;
+    while (top)
+    {
+        const node& n=nodes[stack[--top]];
+        if (!intersects(n.box,slabs))
+            continue;
+        if (n.right<0)
+        {
+            for (int i=n.first; i<n.first+n.count; i++)
+                candidates[order[i]]=intersects(boxes[order[i]],slabs);
+            continue;
+        }
+        stack[top++]=n.right;
+        stack[top++]=&n-&nodes[0]+1;
+    }
+}
@@ -0,0 +1,106 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+// allocations and time per border of the polyline simplification, usage: polyline_benchmark [border points] [iterations]
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "pcl_polyline.h"
+
+static unsigned long allocations=0;
+
+void* operator new(std::size_t size)
+{
+    allocations++;
+    void* p=malloc(size?size:1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+// what borderExtraction did before: copy in a vector, simplify in a raw array and rebuild the points
+static void copy_based(const pcl::PointCloud<pcl::PointXYZRGBNormal>& input, double tolerance, pcl::PointCloud<pcl::PointXYZ>& output)
+{
+    std::vector<double> pcl_vector;
+    for (unsigned int i=0; i<input.size(); i++)
+    {
+        pcl_vector.push_back(input.at(i).x);
+        pcl_vector.push_back(input.at(i).y);
+        pcl_vector.push_back(input.at(i).z);
+    }
+    double* result=new double[pcl_vector.size()];
+    double* iter=psimpl::simplify_douglas_peucker<3>(pcl_vector.begin(),pcl_vector.end(),tolerance,result);
+    for (double* c=result; c+2<iter; c+=3)
+    {
+        pcl::PointXYZ point;
+        point.x=c[0]; point.y=c[1]; point.z=c[2];
+        output.push_back(point);
+    }
+    delete[] result;
+}
+
+template<typename Function>
+void run(std::string name, int iterations, Function function)
+{
+    unsigned long start_allocations=allocations;
+    auto start=std::chrono::steady_clock::now();
+    unsigned int points=0;
+    for (int i=0; i<iterations; i++)
+        points=function();
+    double time=std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count()/iterations;
+    std::cout<<name<<": "<<(double)(allocations-start_allocations)/iterations<<" allocations per border, "<<time*1e6<<" us, "<<points<<" points"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    int size=argc>1?atoi(argv[1]):400;
+    int iterations=argc>2?atoi(argv[2]):1000;
+    
+    // a noisy closed border of a 1m x 0.5m step, like the ones coming from the boundary estimation
+    pcl::PointCloud<pcl::PointXYZRGBNormal> border;
+    srand(0);
+    for (int i=0; i<size; i++)
+    {
+        double t=4.0*i/size;
+        pcl::PointXYZRGBNormal p;
+        p.x=t<1?t:t<2?1:t<3?3-t:0;
+        p.y=t<1?0:t<2?(t-1)*0.5:t<3?0.5:(4-t)*0.5;
+        p.x+=0.005*((double)rand()/RAND_MAX-0.5);
+        p.y+=0.005*((double)rand()/RAND_MAX-0.5);
+        p.z=1.5;
+        border.push_back(p);
+    }
+    std::cout<<"border of "<<size<<" points, "<<iterations<<" iterations"<<std::endl;
+    
+    pcl::PointCloud<pcl::PointXYZ> output;
+    run("copy based douglas-peucker",iterations,[&](){output.clear(); copy_based(border,0.05,output); return output.size();});
+    const char* names[]={"douglas-peucker","douglas-peucker n","radial distance","reumann-witkam"};
+    for (int method=planner::DOUGLAS_PEUCKER; method<=planner::REUMANN_WITKAM; method++)
+    {
+        run(names[method],iterations,[&]()
+        {
+            output.clear();
+            planner::simplify_polyline(border,method,0.05f,20,output);
+            return output.size();
+        });
+    }
+    return 0;
+}
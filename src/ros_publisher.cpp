@@ -173,6 +173,13 @@ void ros_publisher::publish_normal_cloud(pcl::PointCloud< pcl::PointXYZRGBNormal
     pub_normal_cloud_.publish(msg);
 }
 
+void ros_publisher::publish_normal_cloud(planner::normal_points::Ptr normals, int i)
+{
+    pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
+    planner::toPointCloud(*normals,*cloud);
+    publish_normal_cloud(cloud,i);
+}
+
 void ros_publisher::publish_normal_cloud(pcl::PointCloud< pcl::Normal >::Ptr normals, pcl::PointCloud< pcl::PointXYZRGB >::Ptr points, int i)
 {
     visualization_msgs::MarkerArray msg;
@@ -336,7 +343,7 @@ void ros_publisher::publish_robot_joints(KDL::JntArray const& joints, std::vecto
     pub_ik_joints.publish(last_joint_states);
 }
 
-void ros_publisher::publish_filtered_frames(std::list< foot_with_joints > steps, KDL::Frame World_Camera, int color)
+void ros_publisher::publish_filtered_frames(const candidate_store& steps, KDL::Frame World_Camera, int color)
 {
     visualization_msgs::MarkerArray msg;
     
@@ -353,19 +360,19 @@ void ros_publisher::publish_filtered_frames(std::list< foot_with_joints > steps,
     if (color==2) { marker.color.r=0.6; marker.color.g=0.6; }
     if (color==3) marker.color.g=1;
     
-    for (auto step:steps)
+    for (auto const& step:steps)
     {	
 	KDL::Frame temp = World_Camera.Inverse()*step.World_MovingFoot;
 	geometry_msgs::Point point;
 	point.x=temp.p.x();
 	point.y=temp.p.y();
 	point.z=temp.p.z();
-	marker.ns="samples"+std::to_string((long long unsigned int)&step);
 	marker.points.push_back(point);
-        marker.id=(long long unsigned int)&step;
-	
-        msg.markers.push_back(marker);
     }
+    // all the frames of a filter in a single list of spheres
+    marker.ns="samples";
+    marker.id=color;
+    msg.markers.push_back(marker);
     pub_filtered_frames.publish(msg);
 }
 
@@ -28,7 +28,7 @@ rosServer::rosServer(ros::NodeHandle* nh_,double period,std::string robot_name_)
 // RateThread(period),
 period(period),
 nh(nh_), priv_nh_("~"),publisher(*nh,nh->resolveName("/camera_link"),robot_name_),
-command_interface("footstep_planner"),status_interface("footstep_planner"),footstep_planner(robot_name_,&publisher)
+command_interface("footstep_planner"),status_interface("footstep_planner"),footstep_planner(robot_name_,&publisher),cloud_ingestion(&curvature_filter)
 {
     // init publishers and subscribers
     
@@ -47,6 +47,27 @@ command_interface("footstep_planner"),status_interface("footstep_planner"),foots
     priv_nh_.param<int>("min_cluster_size", min_cluster_size_, 50);
     priv_nh_.param<double>("cluster_tolerance", cluster_tolerance_, 0.05);
     curvature_filter.setParams(curvature_threshold_,voxel_size_,normal_radius_,min_cluster_size_,cluster_tolerance_);
+    border_extraction.setRasterSize(voxel_size_);
+    
+    double map_voxel_size_,map_normal_threshold_,map_change_fraction_;
+    int map_min_voxel_points_;
+    priv_nh_.param<double>("map_voxel_size", map_voxel_size_, 0.05);
+    priv_nh_.param<double>("map_normal_threshold", map_normal_threshold_, 0.985);
+    priv_nh_.param<double>("map_change_fraction", map_change_fraction_, 0.05);
+    priv_nh_.param<int>("map_min_voxel_points", map_min_voxel_points_, 3);
+    plane_map.setParams(map_voxel_size_,map_normal_threshold_,map_change_fraction_,map_min_voxel_points_);
+    param_manager::register_param("plane_map",use_plane_map_);
+    param_manager::update_param("plane_map",0);
+    
+    // clouds can be received and preprocessed in background, so that a capture does not wait for them;
+    // it is off by default because the preprocessing of every frame competes for the cores with the planning
+    bool background_ingestion_,ingestion_drop_frames_;
+    int ingestion_buffer_size_;
+    priv_nh_.param<bool>("background_ingestion", background_ingestion_, false);
+    priv_nh_.param<int>("ingestion_buffer_size", ingestion_buffer_size_, 2);
+    priv_nh_.param<bool>("ingestion_drop_frames", ingestion_drop_frames_, true);
+    if (background_ingestion_)
+        cloud_ingestion.start(*nh,nh->resolveName("/camera/depth_registered/points"),ingestion_buffer_size_,ingestion_drop_frames_);
     
     double feasible_area_=2.5;
     priv_nh_.param<double>("feasible_area", feasible_area_, 2.5);
@@ -305,7 +326,14 @@ bool rosServer::single_check(bool ik_only, bool move)
 
 bool rosServer::extractBorders(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
 {
-    polygons=border_extraction.extractBorders(clusters);
+    spatialIndex::Ptr index=curvature_filter.getSpatialIndex();
+    polygons=border_extraction.extractBorders(clusters,index.get());
+    if (use_plane_map_ && index)
+    {
+        plane_map.insertPlanes(*index,polygons);
+        plane_map.appendReusedPolygons(polygons);
+    }
+    footstep_planner.indexAffordances(polygons);
     publisher.publish_plane_borders(polygons); 
 //     int i=0;
 //     for (auto polygon:polygons)
@@ -322,15 +350,8 @@ bool rosServer::extractBorders(std_srvs::Empty::Request& request, std_srvs::Empt
 
 bool rosServer::singleFoot(bool left)
 {
-    std::list<polygon_with_normals> poly;
-    for (auto polygon:polygons)
-    {
-      polygon_with_normals temp;
-      temp.average_normal=polygon.average_normal;
-      temp.border=polygon.border->makeShared();
-      temp.normals=polygon.normals->makeShared();
-      poly.push_back(temp);
-    }
+    // the filters only drop polygons from the list and normals from the selections, borders and normals are shared
+    std::list<polygon_with_normals> poly(polygons);
     auto World_centroids=footstep_planner.getFeasibleCentroids(poly,left);
     publisher.publish_plane_borders(polygons);
     ros::Duration sleep_time(0.2);
@@ -432,6 +453,7 @@ bool rosServer::planFootsteps(std_srvs::Empty::Request& request, std_srvs::Empty
            std::cout<<"problems while reading from file, you should call the [/filter_by_curvature] services first"<<std::endl;
            return false;
         }
+        footstep_planner.indexAffordances(polygons);
     }
     std::cout<<std::endl<<"> Number of polygons: "<<polygons.size()<<std::endl;
     
@@ -451,21 +473,58 @@ bool rosServer::planFootsteps(std_srvs::Empty::Request& request, std_srvs::Empty
 
 bool rosServer::filterByCurvature(std_srvs::Empty::Request& request, std_srvs::Empty::Response& response)
 {
+    // points out of reach of the next step are not worth processing
+    Eigen::Vector3f Camera_center;
+    double radius;
+    if (footstep_planner.getRegionOfInterest(Camera_center,radius))
+        curvature_filter.setRegionOfInterest(Camera_center,radius);
     
-    // wait for a point cloud
-    std::string topic = nh->resolveName("/camera/depth_registered/points");
-    ROS_INFO("waiting for a point_cloud2 on topic %s", topic.c_str());
-    sensor_msgs::PointCloud2::ConstPtr input = ros::topic::waitForMessage<sensor_msgs::PointCloud2>(topic, *nh, ros::Duration(3.0));
-    if (!input)
+    if (use_plane_map_)
     {
-        ROS_ERROR("no point_cloud2 has been received");
-        return false;
+        KDL::Frame World_Camera=footstep_planner.getWorldTransform();
+        Eigen::Affine3f World_Camera_eigen=Eigen::Affine3f::Identity();
+        for (int i=0;i<3;i++)
+        {
+            for (int j=0;j<3;j++)
+                World_Camera_eigen.linear()(i,j)=World_Camera.M(i,j);
+            World_Camera_eigen.translation()[i]=World_Camera.p[i];
+        }
+        curvature_filter.setPlaneMap(&plane_map,World_Camera_eigen);
+    }
+    else
+    {
+        curvature_filter.setPlaneMap(NULL,Eigen::Affine3f::Identity());
+        plane_map.reset();
     }
     
-    // convert from sensor_msgs to a tractable PCL object
-    pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
-    pcl::fromROSMsg(*input, *input_cloud_ptr);
-    clusters=curvature_filter.filterByCurvature(&publisher,input_cloud_ptr);
+    std::string topic = nh->resolveName("/camera/depth_registered/points");
+    if (cloud_ingestion.isRunning())
+    {
+        // take a frame already preprocessed in background
+        spatialIndex::Ptr index;
+        if (!cloud_ingestion.getFrame(index,ros::Duration(3.0)))
+        {
+            ROS_ERROR("no point_cloud2 has been processed from topic %s", topic.c_str());
+            return false;
+        }
+        clusters=curvature_filter.filterByCurvature(&publisher,index);
+    }
+    else
+    {
+        // wait for a point cloud
+        ROS_INFO("waiting for a point_cloud2 on topic %s", topic.c_str());
+        sensor_msgs::PointCloud2::ConstPtr input = ros::topic::waitForMessage<sensor_msgs::PointCloud2>(topic, *nh, ros::Duration(3.0));
+        if (!input)
+        {
+            ROS_ERROR("no point_cloud2 has been received");
+            return false;
+        }
+        
+        // convert from sensor_msgs to a tractable PCL object
+        pcl::PointCloud<pcl::PointXYZRGB>::Ptr input_cloud_ptr (new pcl::PointCloud<pcl::PointXYZRGB>);
+        pcl::fromROSMsg(*input, *input_cloud_ptr);
+        clusters=curvature_filter.filterByCurvature(&publisher,input_cloud_ptr);
+    }
     //publisher.publish_plane_clusters(clusters);
     return extractBorders(request,response);
 }
@@ -40,6 +40,7 @@
 
 #include <iostream>
 #include <vector>
+#include <thread>
 #include <pcl/common/eigen.h>
 #include <sampling_surface.h>
 
@@ -47,88 +48,56 @@
 template<typename PointT> void
 pcl::SamplingSurface<PointT>::applyFilter (PointCloud &output)
 {
-  std::vector <int> indices;
-  size_t npts = input_->points.size ();
-  for (unsigned int i = 0; i < npts; i++)
-    indices.push_back (i);
-
-  Vector max_vec (3, 1);
-  Vector min_vec (3, 1);
-  findXYZMaxMin (*input_, max_vec, min_vec);
-  PointCloud data = *input_;
-  partition (data, 0, npts, min_vec, max_vec, indices, output);
+  sample (final_indices);
+  output.points.resize (final_indices.size ());
+  for (size_t i = 0; i < final_indices.size (); i++)
+    output.points[i] = input_->points[final_indices[i]];
   output.width = 1;
   output.height = uint32_t (output.points.size ());
-  std::cout<<"size:"<<final_indices.size()<<std::endl;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
-template<typename PointT> void 
-pcl::SamplingSurface<PointT>::findXYZMaxMin (const PointCloud& cloud, Vector& max_vec, Vector& min_vec)
+template<typename PointT> void
+pcl::SamplingSurface<PointT>::sample (std::vector<int>& output)
 {
-  float maxval = cloud.points[0].x;
-  float minval = cloud.points[0].x;
-
-  for (unsigned int i = 0; i < cloud.points.size (); i++)
-  {
-    if (cloud.points[i].x > maxval)
-    {
-      maxval = cloud.points[i].x;
-    }
-    if (cloud.points[i].x < minval)
-    {
-      minval = cloud.points[i].x;
-    }
-  }
-  max_vec (0) = maxval;
-  min_vec (0) = minval;
-
-  maxval = cloud.points[0].y;
-  minval = cloud.points[0].y;
-
-  for (unsigned int i = 0; i < cloud.points.size (); i++)
+  output.clear ();
+  if (!this->initCompute ())
+    return;
+  // only the indices are partitioned, the points are read in place
+  std::vector <int> indices (*indices_);
+  if (!indices.empty ())
   {
-    if (cloud.points[i].y > maxval)
-    {
-      maxval = cloud.points[i].y;
-    }
-    if (cloud.points[i].y < minval)
-    {
-      minval = cloud.points[i].y;
-    }
+    Vector max_vec, min_vec;
+    findXYZMaxMin (*input_, indices, max_vec, min_vec);
+    partition (*input_, 0, static_cast<int> (indices.size ()), min_vec, max_vec, indices, threads_, output);
   }
-  max_vec (1) = maxval;
-  min_vec (1) = minval;
-
-  maxval = cloud.points[0].z;
-  minval = cloud.points[0].z;
+  this->deinitCompute ();
+}
 
-  for (unsigned int i = 0; i < cloud.points.size (); i++)
+///////////////////////////////////////////////////////////////////////////////
+template<typename PointT> void 
+pcl::SamplingSurface<PointT>::findXYZMaxMin (const PointCloud& cloud, const std::vector<int>& indices, Vector& max_vec, Vector& min_vec)
+{
+  max_vec = min_vec = cloud.points[indices[0]].getVector3fMap ();
+  for (size_t i = 1; i < indices.size (); i++)
   {
-    if (cloud.points[i].z > maxval)
-    {
-      maxval = cloud.points[i].z;
-    }
-    if (cloud.points[i].z < minval)
-    {
-      minval = cloud.points[i].z;
-    }
+    const Vector p = cloud.points[indices[i]].getVector3fMap ();
+    max_vec = max_vec.cwiseMax (p);
+    min_vec = min_vec.cwiseMin (p);
   }
-  max_vec (2) = maxval;
-  min_vec (2) = minval;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 template<typename PointT> void 
 pcl::SamplingSurface<PointT>::partition (
     const PointCloud& cloud, const int first, const int last,
-    const Vector min_values, const Vector max_values, 
-    std::vector<int>& indices, PointCloud&  output)
+    const Vector& min_values, const Vector& max_values, 
+    std::vector<int>& indices, int threads, std::vector<int>& output)
 {
 	const int count (last - first);
   if (count <= static_cast<int> (sample_))
   {
-    samplePartition (cloud, first, last, indices, output);
+    samplePartition (first, last, indices, output);
     return;
   }
 	int cutDim = 0;
@@ -152,32 +121,39 @@ pcl::SamplingSurface<PointT>::partition (
 	Vector rightMinValues (min_values);
 	rightMinValues[cutDim] = cutVal;
 	
-	// recurse
-	partition (cloud, first, first + leftCount, min_values, leftMaxValues, indices, output);
-	partition (cloud, first + leftCount, last, rightMinValues, max_values, indices, output);
+	// recurse, the two halves work on disjoint ranges of indices
+  if (threads > 1 && count >= static_cast<int> (parallel_threshold_))
+  {
+    std::vector<int> right_output;
+    std::thread right ([&] ()
+    {
+      partition (cloud, first + leftCount, last, rightMinValues, max_values, indices, threads - threads / 2, right_output);
+    });
+    partition (cloud, first, first + leftCount, min_values, leftMaxValues, indices, threads / 2, output);
+    right.join ();
+    output.insert (output.end (), right_output.begin (), right_output.end ());
+    return;
+  }
+	partition (cloud, first, first + leftCount, min_values, leftMaxValues, indices, 1, output);
+	partition (cloud, first + leftCount, last, rightMinValues, max_values, indices, 1, output);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 template<typename PointT> void 
 pcl::SamplingSurface<PointT>::samplePartition (
-    const PointCloud& data, const int first, const int last,
-    std::vector <int>& indices, PointCloud& output)
+    const int first, const int last,
+    const std::vector <int>& indices, std::vector<int>& output)
 {
   float ratio = ratio_;
   if(ratio_*(last-first)<min_sample) ratio = ((float)min_sample)/(last-first);
   
+  // a grid is identified by its first index, so its samples do not depend on the order the grids are visited
+  std::minstd_rand generator (seed_ ^ (static_cast<unsigned int> (first) * 2654435761u));
+  std::uniform_real_distribution<float> uniform (0.0f, 1.0f);
   for (int i = first; i < last; i++)
   {
-    // TODO: change to Boost random number generators!
-    const float r = float (std::rand ()) / float (RAND_MAX);
-
-    if (r < ratio)
-    {
-      output.points.push_back (data.points[indices[i]]);
-      final_indices.push_back(indices[i]);
- 
-    }
-    
+    if (uniform (generator) < ratio)
+      output.push_back (indices[i]);
   }
   return;
 }
@@ -0,0 +1,86 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "spatialindex.h"
+
+using namespace planner;
+
+spatialIndex::spatialIndex(pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr cloud):cloud(cloud)
+{
+}
+
+pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr spatialIndex::getCloud() const
+{
+    return cloud;
+}
+
+pcl::search::KdTree< pcl::PointXYZRGBNormal >::Ptr spatialIndex::getTree()
+{
+    if (!tree)
+    {
+        tree.reset(new pcl::search::KdTree<pcl::PointXYZRGBNormal>);
+        tree->setInputCloud(cloud);
+    }
+    return tree;
+}
+
+void spatialIndex::setClusters(const std::vector< pcl::PointIndices >& clusters)
+{
+    this->clusters=clusters;
+    cluster_clouds.clear();
+    labels.assign(cloud->size(),-1);
+    for (unsigned int c=0;c<clusters.size();c++)
+        for (auto point:clusters[c].indices)
+            labels[point]=c;
+}
+
+const std::vector< pcl::PointIndices >& spatialIndex::getClusters() const
+{
+    return clusters;
+}
+
+int spatialIndex::getLabel(int point) const
+{
+    if (labels.empty()) return -1;
+    return labels[point];
+}
+
+void spatialIndex::setClusterClouds(const std::vector< pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr >& cluster_clouds)
+{
+    this->cluster_clouds=cluster_clouds;
+}
+
+bool spatialIndex::hasClusterClouds(const std::vector< pcl::PointCloud< pcl::PointXYZRGBNormal >::Ptr >& cluster_clouds) const
+{
+    // the same clouds, not only the same number of clusters
+    return this->cluster_clouds.size()==clusters.size() && this->cluster_clouds==cluster_clouds;
+}
+
+int spatialIndex::radiusSearchInCluster(int point, double radius, std::vector< int >& indices, std::vector< float >& squared_distances)
+{
+    getTree()->radiusSearch(point,radius,indices,squared_distances);
+    int label=getLabel(point);
+    unsigned int kept=0;
+    for (unsigned int i=0;i<indices.size();i++)
+    {
+        if (!labels.empty() && labels[indices[i]]!=label)
+            continue;
+        indices[kept]=indices[i];
+        squared_distances[kept]=squared_distances[i];
+        kept++;
+    }
+    indices.resize(kept);
+    squared_distances.resize(kept);
+    return kept;
+}
@@ -32,23 +32,17 @@ void tilt_filter::set_max_tilt(double max_tilt_)
 
 bool tilt_filter::normal_is_in_bounds(pcl::PointXYZRGBNormal& normal)
 {
-    KDL::Vector Camera_point;
-    Camera_point.x(normal.x);
-    Camera_point.y(normal.y);
-    Camera_point.z(normal.z);
-    KDL::Vector Camera_normal;
-    Camera_normal.x(normal.normal_x);
-    Camera_normal.y(normal.normal_y);
-    Camera_normal.z(normal.normal_z);
-    
-    World_point = World_Camera*Camera_point;
-    World_normal = World_Camera*Camera_normal;
-    
-    KDL::Vector ground_normal(0,0,1);
-    KDL::Vector n(World_normal.x()-World_point.x(),World_normal.y()-World_point.y(),World_normal.z()-World_point.z());
+    return normal_is_in_bounds(normal.normal_x,normal.normal_y,normal.normal_z);
+}
+
+bool tilt_filter::normal_is_in_bounds(float normal_x, float normal_y, float normal_z)
+{
+    // normals are directions, only the rotation applies
+    KDL::Vector Camera_normal(normal_x,normal_y,normal_z);
+    KDL::Vector n = World_Camera.M*Camera_normal;
     n = n/n.Norm();
   
-    value = dot(ground_normal,n);
+    value = n.z();
 
 // 	std::cout<<"||TILT: "<<n.x()<<' '<<n.y()<<' '<<n.z()<<" => "<<value<<std::endl;
     
@@ -57,6 +51,29 @@ bool tilt_filter::normal_is_in_bounds(pcl::PointXYZRGBNormal& normal)
 	return true;
 }
 
+tilt_predicate tilt_filter::get_single_normal_predicate()
+{
+    if(!world_set)
+    {
+        tilt_predicate predicate;
+        predicate.enabled=false;
+        std::cout<<"ERROR: STANCE FOOT NOT SET"<<std::endl;
+        return predicate;
+    }
+    
+    return get_single_normal_predicate(World_Camera.M);
+}
+
+tilt_predicate tilt_filter::get_single_normal_predicate(const KDL::Rotation& World_Points)
+{
+    tilt_predicate predicate;
+    predicate.enabled=true;
+    for (int j=0; j<3; j++)
+        predicate.vertical[j]=World_Points(2,j);
+    predicate.max_tilt=max_tilt;
+    return predicate;
+}
+
 void tilt_filter::filter_normals(std::list<polygon_with_normals>& data)
 {
     if(!world_set)
@@ -86,19 +103,22 @@ void tilt_filter::filter_single_normals(std::list< polygon_with_normals >& data)
     
     int temp=0;
     
-    for(auto item:data)
+    for(auto& item:data)
     {	  
-        pcl::PointCloud<pcl::PointXYZRGBNormal> points;
+        const normal_points& points=*item.normals;
+        std::vector<unsigned int>& selection=item.selection;
+        unsigned int kept=0;
 
-        for(pcl::PointCloud<pcl::PointXYZRGBNormal>::iterator it=item.normals->begin(); it!=item.normals->end();++it)
+        for(unsigned int i=0; i<selection.size(); i++)
 	{
-            if(normal_is_in_bounds(*it))
+            unsigned int j=selection[i];
+            if(normal_is_in_bounds(points.normal_x[j],points.normal_y[j],points.normal_z[j]))
 	    {
-                points.push_back(*it);
+                selection[kept++]=j;
 	    }
 	}
 	
-        *(item.normals) = points;
+        selection.resize(kept);
 
     }
 }
\ No newline at end of file
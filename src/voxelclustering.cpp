@@ -0,0 +1,133 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "voxelclustering.h"
+#include "voxel_key.h"
+#include <cmath>
+#include <map>
+
+using namespace planner;
+
+voxelClustering::voxelClustering():voxel_size_(0.01),min_cluster_size_(1),normal_threshold_(0.9995)
+{
+}
+
+void voxelClustering::setVoxelSize(double voxel_size_)
+{
+    this->voxel_size_=voxel_size_;
+}
+
+void voxelClustering::setMinClusterSize(int min_cluster_size_)
+{
+    this->min_cluster_size_=min_cluster_size_;
+}
+
+void voxelClustering::setNormalThreshold(double normal_threshold_)
+{
+    this->normal_threshold_=normal_threshold_;
+}
+
+int voxelClustering::find(int i)
+{
+    while (parent[i]!=i)
+    {
+        parent[i]=parent[parent[i]]; //path halving
+        i=parent[i];
+    }
+    return i;
+}
+
+void voxelClustering::merge(int a, int b)
+{
+    a=find(a);
+    b=find(b);
+    if (a==b) return;
+    if (size[a]<size[b]) std::swap(a,b);
+    parent[b]=a;
+    size[a]+=size[b];
+}
+
+void voxelClustering::segment(const pcl::PointCloud< pcl::PointXYZRGBNormal >& cloud, std::vector< pcl::PointIndices >& cluster_indices, const std::vector< bool >* mask)
+{
+    cluster_indices.clear();
+    int N=cloud.size();
+    double inverse_size=1.0/voxel_size_;
+    
+    voxels.clear();
+    voxels.reserve(N);
+    next.assign(N,-1);
+    parent.resize(N);
+    size.assign(N,1);
+    std::vector<int64_t> coords(3*N);
+    
+    for (int p=0;p<N;p++)
+    {
+        parent[p]=p;
+        if (mask && !(*mask)[p])
+            continue;
+        coords[3*p]=voxel_coordinate(cloud.points[p].x,inverse_size);
+        coords[3*p+1]=voxel_coordinate(cloud.points[p].y,inverse_size);
+        coords[3*p+2]=voxel_coordinate(cloud.points[p].z,inverse_size);
+        auto inserted=voxels.emplace(voxel_key(coords[3*p],coords[3*p+1],coords[3*p+2]),p);
+        if (!inserted.second)
+        {
+            next[p]=inserted.first->second;
+            inserted.first->second=p;
+        }
+    }
+    
+    for (int p=0;p<N;p++)
+    {
+        if (mask && !(*mask)[p])
+            continue;
+        Eigen::Map<const Eigen::Vector3f> normal_p(cloud.points[p].normal);
+        // only half of the neighbourhood is visited, the other half will visit this point
+        for (int di=-1;di<=1;di++)
+            for (int dj=-1;dj<=1;dj++)
+                for (int dk=-1;dk<=1;dk++)
+                {
+                    if (di<0 || (di==0 && (dj<0 || (dj==0 && dk<0))))
+                        continue;
+                    auto voxel=voxels.find(voxel_key(coords[3*p]+di,coords[3*p+1]+dj,coords[3*p+2]+dk));
+                    if (voxel==voxels.end())
+                        continue;
+                    for (int q=voxel->second;q!=-1;q=next[q])
+                    {
+                        if (q==p) continue;
+                        Eigen::Map<const Eigen::Vector3f> normal_q(cloud.points[q].normal);
+                        if (fabs(normal_p.dot(normal_q))>normal_threshold_)
+                            merge(p,q);
+                    }
+                }
+    }
+    
+    // clusters are sorted by their first point, as the conditional euclidean clustering does
+    std::map<int,int> root_to_cluster;
+    for (int p=0;p<N;p++)
+    {
+        if (mask && !(*mask)[p])
+            continue;
+        int root=find(p);
+        if (size[root]<min_cluster_size_)
+            continue;
+        auto cluster=root_to_cluster.find(root);
+        if (cluster==root_to_cluster.end())
+        {
+            cluster=root_to_cluster.emplace(root,cluster_indices.size()).first;
+            cluster_indices.push_back(pcl::PointIndices());
+            cluster_indices.back().indices.reserve(size[root]);
+        }
+        cluster_indices[cluster->second].indices.push_back(p);
+    }
+}
@@ -0,0 +1,467 @@
+/* Copyright [2014] [Mirko Ferrati, Alessandro Settimi, Corrado Pavan, Carlos J Rosales]
+ * 
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ * 
+ * http://www.apache.org/licenses/LICENSE-2.0
+ * 
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.*/
+
+#include "voxeldownsampler.h"
+#include "voxel_key.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <pcl/features/normal_3d.h>
+
+using namespace planner;
+
+voxelDownsampler::voxelDownsampler():voxel_size_(0.01),max_range_(0),roi_center_(0,0,0),roi_radius_(0),moments_cell_size_(0),threads_(1)
+{
+}
+
+void voxelDownsampler::setLeafSize(double voxel_size_)
+{
+    this->voxel_size_=voxel_size_;
+}
+
+void voxelDownsampler::setMaxRange(double max_range_)
+{
+    this->max_range_=max_range_;
+}
+
+void voxelDownsampler::setRegionOfInterest(const Eigen::Vector3f& roi_center_, double roi_radius_)
+{
+    this->roi_center_=roi_center_;
+    this->roi_radius_=roi_radius_;
+}
+
+void voxelDownsampler::setThreads(int threads_)
+{
+    this->threads_=threads_;
+}
+
+void voxelDownsampler::setMomentsCellSize(double moments_cell_size_)
+{
+    this->moments_cell_size_=moments_cell_size_;
+}
+
+bool voxelDownsampler::isValid(const pcl::PointXYZRGB& p, unsigned int i, const pcl::PointCloud< pcl::Normal >* normals) const
+{
+    if (!pcl_isfinite(p.x) || !pcl_isfinite(p.y) || !pcl_isfinite(p.z))
+        return false;
+    if (max_range_>0 && p.x*p.x+p.y*p.y+p.z*p.z>max_range_*max_range_)
+        return false;
+    if (roi_radius_>0 && (p.getVector3fMap()-roi_center_).squaredNorm()>roi_radius_*roi_radius_)
+        return false;
+    if (normals)
+    {
+        const pcl::Normal& n=normals->points[i];
+        if (!pcl_isfinite(n.normal_x) || !pcl_isfinite(n.normal_y) || !pcl_isfinite(n.normal_z))
+            return false;
+    }
+    return true;
+}
+
+void voxelDownsampler::accumulateMoments(const pcl::PointXYZRGB& p, std::unordered_map< uint64_t, int >& index, std::vector< moments_accumulator >& cells) const
+{
+    double inverse_size=1.0/moments_cell_size_;
+    uint64_t key=voxel_key(voxel_coordinate(p.x,inverse_size),voxel_coordinate(p.y,inverse_size),voxel_coordinate(p.z,inverse_size));
+    auto inserted=index.emplace(key,cells.size());
+    if (inserted.second)
+    {
+        cells.push_back(moments_accumulator());
+        memset(&cells.back(),0,sizeof(moments_accumulator));
+    }
+    moments_accumulator& cell=cells[inserted.first->second];
+    cell.sum[0]+=p.x; cell.sum[1]+=p.y; cell.sum[2]+=p.z;
+    cell.sum_squares[0]+=(double)p.x*p.x; cell.sum_squares[1]+=(double)p.x*p.y; cell.sum_squares[2]+=(double)p.x*p.z;
+    cell.sum_squares[3]+=(double)p.y*p.y; cell.sum_squares[4]+=(double)p.y*p.z; cell.sum_squares[5]+=(double)p.z*p.z;
+    cell.count++;
+}
+
+void voxelDownsampler::filter(const pcl::PointCloud< pcl::PointXYZRGB >& input, pcl::PointCloud< pcl::PointXYZRGBNormal >& output, const pcl::PointCloud< pcl::Normal >* normals)
+{
+    // clear() keeps the memory of the previous capture
+    moments_index.clear();
+    moments.clear();
+    
+    int threads=threads_>0?threads_:std::thread::hardware_concurrency();
+    if (threads<=1)
+        filterSerial(input,output,normals);
+    else
+        filterParallel(input,output,normals,threads);
+    
+    output.width=output.points.size();
+    output.height=1;
+    output.is_dense=true;
+    output.header=input.header;
+}
+
+void voxelDownsampler::filterSerial(const pcl::PointCloud< pcl::PointXYZRGB >& input, pcl::PointCloud< pcl::PointXYZRGBNormal >& output, const pcl::PointCloud< pcl::Normal >* normals)
+{
+    double inverse_size=1.0/voxel_size_;
+    
+    voxel_index.clear();
+    accumulators.clear();
+    
+    for (unsigned int i=0;i<input.points.size();i++)
+    {
+        const pcl::PointXYZRGB& p=input.points[i];
+        if (!isValid(p,i,normals))
+            continue;
+        if (moments_cell_size_>0)
+            accumulateMoments(p,moments_index,moments);
+        
+        uint64_t key=voxel_key(voxel_coordinate(p.x,inverse_size),voxel_coordinate(p.y,inverse_size),voxel_coordinate(p.z,inverse_size));
+        auto inserted=voxel_index.emplace(key,accumulators.size());
+        if (inserted.second)
+        {
+            voxel_accumulator first;
+            first.x=p.x; first.y=p.y; first.z=p.z;
+            first.rgb=p.rgb;
+            first.count=1;
+            first.normal_x=first.normal_y=first.normal_z=first.curvature=0;
+            if (normals)
+            {
+                const pcl::Normal& n=normals->points[i];
+                first.normal_x=n.normal_x; first.normal_y=n.normal_y; first.normal_z=n.normal_z;
+                first.curvature=n.curvature;
+            }
+            accumulators.push_back(first);
+            continue;
+        }
+        
+        voxel_accumulator& voxel=accumulators[inserted.first->second];
+        voxel.x+=p.x; voxel.y+=p.y; voxel.z+=p.z;
+        voxel.count++;
+        if (normals)
+        {
+            const pcl::Normal& n=normals->points[i];
+            voxel.normal_x+=n.normal_x; voxel.normal_y+=n.normal_y; voxel.normal_z+=n.normal_z;
+            voxel.curvature+=n.curvature;
+        }
+    }
+    
+    output.points.resize(accumulators.size());
+    for (unsigned int v=0;v<accumulators.size();v++)
+    {
+        const voxel_accumulator& voxel=accumulators[v];
+        pcl::PointXYZRGBNormal& point=output.points[v];
+        point.x=voxel.x/voxel.count;
+        point.y=voxel.y/voxel.count;
+        point.z=voxel.z/voxel.count;
+        point.rgb=voxel.rgb;
+        point.normal_x=point.normal_y=point.normal_z=point.curvature=0;
+        if (normals)
+        {
+            float norm=sqrt(voxel.normal_x*voxel.normal_x+voxel.normal_y*voxel.normal_y+voxel.normal_z*voxel.normal_z);
+            if (norm>0)
+            {
+                point.normal_x=voxel.normal_x/norm;
+                point.normal_y=voxel.normal_y/norm;
+                point.normal_z=voxel.normal_z/norm;
+            }
+            point.curvature=voxel.curvature/voxel.count;
+        }
+    }
+}
+
+namespace
+{
+// the threads of a frame wait here for each other between two phases
+class phase_barrier
+{
+public:
+    explicit phase_barrier(int threads):threads(threads),waiting(0),phase(0) {}
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        unsigned int current=phase;
+        if (++waiting==threads)
+        {
+            waiting=0;
+            phase++;
+            all_arrived.notify_all();
+            return;
+        }
+        all_arrived.wait(lock,[&]{return phase!=current;});
+    }
+private:
+    int threads,waiting;
+    unsigned int phase;
+    std::mutex mutex;
+    std::condition_variable all_arrived;
+};
+
+inline unsigned int slice_begin(unsigned int size, int t, int threads)
+{
+    return (uint64_t)size*t/threads;
+}
+}
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1<<RADIX_BITS)
+
+void voxelDownsampler::filterParallel(const pcl::PointCloud< pcl::PointXYZRGB >& input, pcl::PointCloud< pcl::PointXYZRGBNormal >& output, const pcl::PointCloud< pcl::Normal >* normals, int threads)
+{
+    double inverse_size=1.0/voxel_size_;
+    unsigned int N=input.points.size();
+    
+    keys.resize(N);
+    points.resize(N);
+    keys_swap.resize(N);
+    points_swap.resize(N);
+    thread_moments_index.resize(threads);
+    thread_moments.resize(threads);
+    std::vector<unsigned int> valid(threads,0), runs(threads,0);
+    std::vector<uint64_t> keys_or(threads,0), keys_and(threads,~uint64_t(0));
+    std::vector< std::vector<unsigned int> > histograms(threads,std::vector<unsigned int>(RADIX_BUCKETS));
+    phase_barrier barrier(threads);
+    
+    // the threads are started once per frame and go through all the phases, separated by the barrier;
+    // the small serial steps (prefix sums over the threads) are repeated by every thread on its own copy
+    auto worker=[&](int t)
+    {
+        // keys of the valid points, every thread writes its slice and counts the valid ones
+        unsigned int begin=slice_begin(N,t,threads), end=slice_begin(N,t+1,threads);
+        thread_moments_index[t].clear();
+        thread_moments[t].clear();
+        unsigned int kept=begin;
+        for (unsigned int i=begin;i<end;i++)
+        {
+            const pcl::PointXYZRGB& p=input.points[i];
+            if (!isValid(p,i,normals))
+                continue;
+            if (moments_cell_size_>0)
+                accumulateMoments(p,thread_moments_index[t],thread_moments[t]);
+            keys[kept]=voxel_key(voxel_coordinate(p.x,inverse_size),voxel_coordinate(p.y,inverse_size),voxel_coordinate(p.z,inverse_size));
+            points[kept]=i;
+            keys_or[t]|=keys[kept];
+            keys_and[t]&=keys[kept];
+            kept++;
+        }
+        valid[t]=kept-begin;
+        barrier.wait();
+        
+        // compact the slices into the second buffer
+        uint64_t bits_or=0, bits_and=~uint64_t(0);
+        unsigned int M=0, offset=0;
+        for (int other=0;other<threads;other++)
+        {
+            bits_or|=keys_or[other];
+            bits_and&=keys_and[other];
+            if (other==t)
+                offset=M;
+            M+=valid[other];
+        }
+        std::copy(keys.begin()+begin,keys.begin()+begin+valid[t],keys_swap.begin()+offset);
+        std::copy(points.begin()+begin,points.begin()+begin+valid[t],points_swap.begin()+offset);
+        uint64_t* current_keys=keys_swap.data();
+        uint64_t* other_keys=keys.data();
+        unsigned int* current_points=points_swap.data();
+        unsigned int* other_points=points.data();
+        
+        // the moments of the slices are merged by the first thread, there are only a few coarse cells
+        if (t==0 && moments_cell_size_>0)
+        {
+            for (int other=0;other<threads;other++)
+                for (auto& cell:thread_moments_index[other])
+                {
+                    const moments_accumulator& source=thread_moments[other][cell.second];
+                    auto inserted=moments_index.emplace(cell.first,moments.size());
+                    if (inserted.second)
+                    {
+                        moments.push_back(source);
+                        continue;
+                    }
+                    moments_accumulator& target=moments[inserted.first->second];
+                    for (int k=0;k<3;k++) target.sum[k]+=source.sum[k];
+                    for (int k=0;k<6;k++) target.sum_squares[k]+=source.sum_squares[k];
+                    target.count+=source.count;
+                }
+        }
+        barrier.wait();
+        
+        // stable LSD radix sort of the keys, digits that are the same for every key are skipped
+        begin=slice_begin(M,t,threads);
+        end=slice_begin(M,t+1,threads);
+        std::vector<unsigned int> position(RADIX_BUCKETS);
+        for (int shift=0;shift<64;shift+=RADIX_BITS)
+        {
+            if ((((bits_or^bits_and)>>shift)&(RADIX_BUCKETS-1))==0)
+                continue;
+            std::fill(histograms[t].begin(),histograms[t].end(),0);
+            for (unsigned int i=begin;i<end;i++)
+                histograms[t][(current_keys[i]>>shift)&(RADIX_BUCKETS-1)]++;
+            barrier.wait();
+            // first position of this thread in each bucket
+            unsigned int first=0;
+            for (int digit=0;digit<RADIX_BUCKETS;digit++)
+                for (int other=0;other<threads;other++)
+                {
+                    if (other==t)
+                        position[digit]=first;
+                    first+=histograms[other][digit];
+                }
+            for (unsigned int i=begin;i<end;i++)
+            {
+                unsigned int target=position[(current_keys[i]>>shift)&(RADIX_BUCKETS-1)]++;
+                other_keys[target]=current_keys[i];
+                other_points[target]=current_points[i];
+            }
+            std::swap(current_keys,other_keys);
+            std::swap(current_points,other_points);
+            barrier.wait();
+        }
+        
+        // every run of equal keys is a voxel, the first point of a run is the first one of the input
+        for (unsigned int i=begin;i<end;i++)
+            if (i==0 || current_keys[i]!=current_keys[i-1])
+                runs[t]++;
+        barrier.wait();
+        unsigned int V=0, run=0;
+        for (int other=0;other<threads;other++)
+        {
+            if (other==t)
+                run=V;
+            V+=runs[other];
+        }
+        if (t==0)
+        {
+            voxel_begin.resize(V+1);
+            voxel_begin[V]=M;
+            output.points.resize(V);
+        }
+        barrier.wait();
+        for (unsigned int i=begin;i<end;i++)
+            if (i==0 || current_keys[i]!=current_keys[i-1])
+                voxel_begin[run++]=i;
+        barrier.wait();
+        
+        begin=slice_begin(V,t,threads);
+        end=slice_begin(V,t+1,threads);
+        for (unsigned int v=begin;v<end;v++)
+        {
+            double x=0,y=0,z=0;
+            float normal_x=0,normal_y=0,normal_z=0,curvature=0;
+            unsigned int count=voxel_begin[v+1]-voxel_begin[v];
+            for (unsigned int i=voxel_begin[v];i<voxel_begin[v+1];i++)
+            {
+                const pcl::PointXYZRGB& p=input.points[current_points[i]];
+                x+=p.x; y+=p.y; z+=p.z;
+                if (normals)
+                {
+                    const pcl::Normal& n=normals->points[current_points[i]];
+                    normal_x+=n.normal_x; normal_y+=n.normal_y; normal_z+=n.normal_z;
+                    curvature+=n.curvature;
+                }
+            }
+            pcl::PointXYZRGBNormal& point=output.points[v];
+            point.x=x/count;
+            point.y=y/count;
+            point.z=z/count;
+            point.rgb=input.points[current_points[voxel_begin[v]]].rgb;
+            point.normal_x=point.normal_y=point.normal_z=point.curvature=0;
+            if (normals)
+            {
+                float norm=sqrt(normal_x*normal_x+normal_y*normal_y+normal_z*normal_z);
+                if (norm>0)
+                {
+                    point.normal_x=normal_x/norm;
+                    point.normal_y=normal_y/norm;
+                    point.normal_z=normal_z/norm;
+                }
+                point.curvature=curvature/count;
+            }
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    for (int t=1;t<threads;t++)
+        pool.emplace_back(worker,t);
+    worker(0);
+    for (auto& thread:pool)
+        thread.join();
+}
+
+void voxelDownsampler::solveNeighbourhood(int64_t ci, int64_t cj, int64_t ck, float& normal_x, float& normal_y, float& normal_z, float& curvature) const
+{
+    double sum[3]={0,0,0}, sum_squares[6]={0,0,0,0,0,0};
+    unsigned int count=0;
+    for (int di=-1;di<=1;di++)
+        for (int dj=-1;dj<=1;dj++)
+            for (int dk=-1;dk<=1;dk++)
+            {
+                auto neighbour=moments_index.find(voxel_key(ci+di,cj+dj,ck+dk));
+                if (neighbour==moments_index.end())
+                    continue;
+                const moments_accumulator& n=moments[neighbour->second];
+                for (int k=0;k<3;k++) sum[k]+=n.sum[k];
+                for (int k=0;k<6;k++) sum_squares[k]+=n.sum_squares[k];
+                count+=n.count;
+            }
+    if (count<3)
+    {
+        normal_x=normal_y=normal_z=curvature=std::numeric_limits<float>::quiet_NaN();
+        return;
+    }
+    double mean[3]={sum[0]/count,sum[1]/count,sum[2]/count};
+    Eigen::Matrix3f covariance;
+    covariance(0,0)=sum_squares[0]/count-mean[0]*mean[0];
+    covariance(0,1)=covariance(1,0)=sum_squares[1]/count-mean[0]*mean[1];
+    covariance(0,2)=covariance(2,0)=sum_squares[2]/count-mean[0]*mean[2];
+    covariance(1,1)=sum_squares[3]/count-mean[1]*mean[1];
+    covariance(1,2)=covariance(2,1)=sum_squares[4]/count-mean[1]*mean[2];
+    covariance(2,2)=sum_squares[5]/count-mean[2]*mean[2];
+    pcl::solvePlaneParameters(covariance,normal_x,normal_y,normal_z,curvature);
+}
+
+void voxelDownsampler::computeNormals(pcl::PointCloud< pcl::PointXYZRGBNormal >& output, bool curvature_only)
+{
+    double inverse_size=1.0/moments_cell_size_;
+    
+    for (unsigned int i=0;i<output.points.size();i++)
+    {
+        pcl::PointXYZRGBNormal& point=output.points[i];
+        int64_t ci=voxel_coordinate(point.x,inverse_size), cj=voxel_coordinate(point.y,inverse_size), ck=voxel_coordinate(point.z,inverse_size);
+        float normal_x,normal_y,normal_z,curvature;
+        auto cell_index=moments_index.find(voxel_key(ci,cj,ck));
+        if (cell_index==moments_index.end())
+        {
+            // the centroid of a voxel across a cell corner can fall in an empty cell, its neighbours still give the normal
+            solveNeighbourhood(ci,cj,ck,normal_x,normal_y,normal_z,curvature);
+        }
+        else
+        {
+            // every point of a cell has the same neighbourhood, so it is solved only once
+            moments_accumulator& cell=moments[cell_index->second];
+            if (!cell.solved)
+            {
+                cell.solved=true;
+                solveNeighbourhood(ci,cj,ck,cell.normal_x,cell.normal_y,cell.normal_z,cell.curvature);
+            }
+            normal_x=cell.normal_x;
+            normal_y=cell.normal_y;
+            normal_z=cell.normal_z;
+            curvature=cell.curvature;
+        }
+        point.curvature=curvature;
+        if (curvature_only)
+            continue;
+        point.normal_x=normal_x;
+        point.normal_y=normal_y;
+        point.normal_z=normal_z;
+        if (pcl_isfinite(point.normal_x))
+            pcl::flipNormalTowardsViewpoint(point,0,0,0,point.normal_x,point.normal_y,point.normal_z);
+    }
+}
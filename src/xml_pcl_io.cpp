@@ -22,7 +22,9 @@ bool xml_pcl_io::write_to_file(std::string filename, const std::list<planner::po
         TiXmlElement * single_augmented_pcl = new TiXmlElement("augmented_pcl");
         TiXmlElement * pcl_xyzrgbanormal = new TiXmlElement("xyzrgbanormal");
         std::ostringstream temp;
-        writer.writeASCII(temp,*(cluster.normals));
+        pcl::PointCloud<pcl::PointXYZRGBNormal> normals;
+        planner::toPointCloud(*(cluster.normals),normals);
+        writer.writeASCII(temp,normals);
         TiXmlText * text = new TiXmlText( temp.str() );
 
         TiXmlElement * pcl_border = new TiXmlElement("border");
@@ -87,7 +89,8 @@ bool xml_pcl_io::read_from_file(std::string filename, std::list<planner::polygon
             pcl::PointCloud<pcl::PointXYZRGBNormal>::Ptr temp(new pcl::PointCloud<pcl::PointXYZRGBNormal>);
             std::istringstream input(pointcloud);
             reader.read(input,*temp);
-            polygon.normals=temp;
+            polygon.normals.reset(new planner::normal_points);
+            planner::fromPointCloud(*temp,*polygon.normals,true);
 
             single_pcl=augmented_pcl->FirstChild("border");
             if (single_pcl==NULL)